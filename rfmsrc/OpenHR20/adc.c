@@ -73,6 +73,10 @@ static int16_t ring_buf[2][AVERAGE_LEN];
 
 static uint8_t ring_pos=0;
 static uint8_t ring_used=0; 
+#if RTC_TICKLESS
+	uint8_t ADC_seconds=1;
+	static int16_t last_bat;
+#endif
 static int32_t ring_sum [2] = {0,0};
 int16_t ring_average [2] = {0,0};
 
@@ -250,7 +254,12 @@ bool task_ADC(void) {
 			#if DEBUG_BATT_ADC
 				COM_printStr16(PSTR("batAD x"),ad);
 			#endif
-			update_ring(BAT_RING_TYPE,ADC_Get_Bat_Voltage(ad));
+			#if RTC_TICKLESS
+				last_bat=ADC_Get_Bat_Voltage(ad);
+				update_ring(BAT_RING_TYPE,last_bat);
+			#else
+				update_ring(BAT_RING_TYPE,ADC_Get_Bat_Voltage(ad));
+			#endif
 
 			// activate voltage divider
 			ADC_ACT_TEMP_P |= (1<<ADC_ACT_TEMP);
@@ -274,6 +283,14 @@ bool task_ADC(void) {
                 COM_debug_print_temperature(t);
             #endif
             shift_ring();
+            #if RTC_TICKLESS
+                // measure stand for all slept seconds, ring keeps time scale
+                for (;ADC_seconds>1;ADC_seconds--) {
+                    update_ring(BAT_RING_TYPE,last_bat);
+                    update_ring(TEMP_RING_TYPE,t);
+                    shift_ring();
+                }
+            #endif
         }
         // do not use break here
 	default:
@@ -82,6 +82,9 @@ bool     ADC_Get_Bat_isOk(void);            // Status of battery ok?
 
 bool task_ADC(void);
 void start_task_ADC(void);
+#if RTC_TICKLESS
+    extern uint8_t ADC_seconds; //!< seconds represented by next measure
+#endif
 
 
 extern bool sleep_with_ADC;
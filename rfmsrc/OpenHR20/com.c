@@ -35,6 +35,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <avr/wdt.h>
+#include <util/crc16.h>
 
 
 #include "config.h"
@@ -49,12 +50,26 @@
 #include "controller.h"
 #include "menu.h"
 #include "../common/wireless.h"
+#include "ota.h"
+#include "motor.h"
 #include "debug.h"
 
 
-#define TX_BUFF_SIZE 128
+// longest output is debug line of COM_print_debug(), 98 bytes in tx_buff
+// with DEBUG_PRINT_I_SUM (labels are 3 byte references, values are chars)
+#define TX_BUFF_SIZE 104
 #define RX_BUFF_SIZE 32
 
+/*
+ * tx_buff is a scatter list: chars are stored directly, text from program
+ * memory and hex dump of variables are stored as reference, UDRE ISR
+ * formats them on the fly (no copy of strings, no hex digits in buffer)
+ *   COM_TX_PGM ptr_l ptr_h          - string in program memory
+ *   COM_TX_HEX ptr_l ptr_h len      - variable in RAM, hex, last byte first
+ */
+#define COM_TX_PGM '\x01'
+#define COM_TX_HEX '\x02'
+
 #define ENABLE_LOCAL_COMMANDS 1
 
 static char tx_buff[TX_BUFF_SIZE];
@@ -65,6 +80,11 @@ static uint8_t tx_buff_out=0;
 static uint8_t rx_buff_in=0;
 static uint8_t rx_buff_out=0;
 
+static uint16_t COM_tx_overflow=0; // dropped chars and references, tx_buff was full
+static uint8_t tx_mode=0;      // reference in progress, COM_TX_PGM or COM_TX_HEX
+static const char * tx_ref;
+static uint8_t tx_nibbles;
+
 /*!
  *******************************************************************************
  *  \brief transmit bytes
@@ -76,23 +96,74 @@ void COM_putchar(char c) {
 	if ((tx_buff_in+1)%TX_BUFF_SIZE!=tx_buff_out) {
 		tx_buff[tx_buff_in++]=c;
 		tx_buff_in%=TX_BUFF_SIZE;
+	} else if (COM_tx_overflow!=0xffff) {
+		COM_tx_overflow++;
+	}
+	sei();
+}
+
+/*!
+ *******************************************************************************
+ *  \brief store reference to tx_buff, see COM_TX_PGM / COM_TX_HEX
+ *
+ *  \note referenced data must be valid until it is sent,
+ *        variables are printed with value in time of sending
+ ******************************************************************************/
+static void COM_put_ref(char mode, const void * p, uint8_t len) {
+	uint8_t n=(mode==COM_TX_HEX)?4:3;
+	cli();
+	if ((uint8_t)(tx_buff_out-tx_buff_in-1+TX_BUFF_SIZE)%TX_BUFF_SIZE>=n) {
+		tx_buff[tx_buff_in]=mode;
+		tx_buff_in=(tx_buff_in+1)%TX_BUFF_SIZE;
+		tx_buff[tx_buff_in]=(uint16_t)p&0xff;
+		tx_buff_in=(tx_buff_in+1)%TX_BUFF_SIZE;
+		tx_buff[tx_buff_in]=(uint16_t)p>>8;
+		tx_buff_in=(tx_buff_in+1)%TX_BUFF_SIZE;
+		if (n==4) {
+			tx_buff[tx_buff_in]=len;
+			tx_buff_in=(tx_buff_in+1)%TX_BUFF_SIZE;
+		}
+	} else if (COM_tx_overflow!=0xffff) {
+		COM_tx_overflow++;
 	}
 	sei();
 }
 
+static uint8_t COM_tx_pop(void) {
+	uint8_t c=tx_buff[tx_buff_out++];
+	tx_buff_out%=TX_BUFF_SIZE;
+	return c;
+}
+
 /*!
  *******************************************************************************
  *  \brief support for interrupt for transmit bytes
  *
- *  \note
+ *  \note walk tx_buff scatter list, references are formatted here
  ******************************************************************************/
 char COM_tx_char_isr(void) {
-	char c='\0';
-	if (tx_buff_in!=tx_buff_out) {
-		c=tx_buff[tx_buff_out++];
-		tx_buff_out%=TX_BUFF_SIZE;
+	char c;
+	for (;;) {
+		if (tx_mode==COM_TX_PGM) {
+			c=pgm_read_byte(tx_ref++);
+			if (c!='\0') return c;
+		} else if (tx_mode==COM_TX_HEX) {
+			if (tx_nibbles!=0) {
+				uint8_t x=((const uint8_t *)tx_ref)[(tx_nibbles-1)>>1];
+				if (tx_nibbles&1) x&=0xf; else x>>=4;
+				tx_nibbles--;
+				return (x>=10)?(x+'a'-10):(x+'0');
+			}
+		}
+		tx_mode=0;
+		if (tx_buff_in==tx_buff_out) return '\0';
+		c=COM_tx_pop();
+		if ((c!=COM_TX_PGM) && (c!=COM_TX_HEX)) return c;
+		tx_mode=c;
+		tx_ref=(const char *)(uint16_t)COM_tx_pop();
+		tx_ref+=(uint16_t)COM_tx_pop()<<8;
+		if (c==COM_TX_HEX) tx_nibbles=COM_tx_pop()*2;
 	}
-	return c;
 }
 
 static volatile uint8_t COM_requests; 
@@ -216,17 +287,22 @@ static void print_hexXXXX(uint16_t i) {
 	print_hexXX(i&0xff);
 }
 
+/*!
+ *******************************************************************************
+ *  \brief helper function print variable as hex number, formatted by ISR
+ *
+ *  \note for global variables only
+ ******************************************************************************/
+#define print_hex_var(v) COM_put_ref(COM_TX_HEX,&(v),sizeof(v))
+
 /*!
  *******************************************************************************
  *  \brief helper function print string without \n2 digit dec number
  *
- *  \note
+ *  \note string is not copied, it is read by ISR
  ******************************************************************************/
 static void print_s_p(const char * s) {
-	char c;
-	for (c = pgm_read_byte(s); c; ++s, c = pgm_read_byte(s)) {
-      COM_putchar(c);
-   	}
+	COM_put_ref(COM_TX_PGM,s,0);
 }
 
 /*!
@@ -238,13 +314,15 @@ static void print_s_p(const char * s) {
 static void print_version(bool sync) {
 	const char * s = (PSTR(VERSION_STRING "\n"));
     COM_putchar('V');
-	char c;
-	for (c = pgm_read_byte(s); c; ++s, c = pgm_read_byte(s)) {
-      COM_putchar(c);
-      #if RFM==1
-        if (sync) wireless_putchar(c);
-      #endif
-   	}
+	print_s_p(s);
+    #if RFM==1
+	if (sync) {
+		char c;
+		for (c = pgm_read_byte(s); c; ++s, c = pgm_read_byte(s)) {
+			wireless_putchar(c);
+		}
+	}
+    #endif
 }
 
 
@@ -301,14 +379,13 @@ void COM_print_debug(uint8_t type) {
 	print_decXXXX(bat_average);
 #if DEBUG_PRINT_I_SUM
 	print_s_p(PSTR(" Is: "));
-	print_hexXXXX(sumError>>16);
-	print_hexXXXX(sumError);
+	print_hex_var(sumError);
 	print_s_p(PSTR(" Ib: ")); //jr
-	print_hexXX(CTL_integratorBlock);
+	print_hex_var(CTL_integratorBlock);
 	print_s_p(PSTR(" Ic: ")); //jr
-	print_hexXX(CTL_interatorCredit);
+	print_hex_var(CTL_interatorCredit);
 	print_s_p(PSTR(" Ie: ")); //jr
-	print_hexXX(CTL_creditExpiration);
+	print_hex_var(CTL_creditExpiration);
 #endif
     if (CTL_error!=0) {
 		print_s_p(PSTR(" E:"));
@@ -401,6 +478,31 @@ static void print_idx(char t, uint8_t i) {
     COM_putchar('=');
 }
 
+/*!
+ *******************************************************************************
+ *  \brief CRC16 (CCITT, init 0xffff) of config_raw or one row of ee_timers
+ *
+ *  \param idx 0-7 timers for day idx, COM_DIGEST_CONFIG for config_raw
+ *  \note bytes are same as in G/R replies, timer word high byte first
+ ******************************************************************************/
+#define COM_DIGEST_CONFIG 8
+static uint16_t COM_digest(uint8_t idx) {
+    uint16_t crc=0xffff;
+    uint8_t i;
+    if (idx==COM_DIGEST_CONFIG) {
+        for (i=0;i<CONFIG_RAW_SIZE;i++) {
+            crc=_crc_ccitt_update(crc,config_raw[i]);
+        }
+    } else {
+        for (i=0;i<RTC_TIMERS_PER_DOW;i++) {
+            uint16_t w=eeprom_timers_read_raw(timers_get_raw_index(idx,i));
+            crc=_crc_ccitt_update(crc,w>>8);
+            crc=_crc_ccitt_update(crc,w&0xff);
+        }
+    }
+    return crc;
+}
+
 
 
 /*!
@@ -423,6 +525,10 @@ static void print_idx(char t, uint8_t i) {
  *  \note   Axx\n - set wanted temperature [unit 0.5C]
  *  \note   Mxx\n - set mode and close window (00=manu 01=auto fd=nochange/close window only)
  * 	\note	Lxx\n - Lock keys, and return lock status (00=unlock, 01=lock, 02=status only)
+ *  \note   C\n - digests, return C[ss]=cccc0000..7777 ss=config size, cccc CRC16 of config, 0000-7777 CRC16 of timers for day 0-7
+ *  \note   Kxx\n - motor run record xx (00=newest), return K[xx]=ssss eeee pppp tttt aaaa kkkk ww oo rr
+ *                  start stop pulses time diag_avg diag_peak pwm overshoot reason, nothing if no record
+ *  \note   E\n - print "E: TX oooo", oooo dropped output (tx_buff full), cleared by this command
  *	
  ******************************************************************************/
 void COM_commad_parse (void) {
@@ -498,6 +604,9 @@ void COM_commad_parse (void) {
 			{
 				if (COM_hex_parse(2*2)!='\0') { break; }
   				if ((com_hex[0]==0x13) && (com_hex[1]==0x24)) {
+#if MOTOR_RESUME
+                      MOTOR_resume_save();
+#endif
                       cli();
                       wdt_enable(WDTO_15MS); //wd on,15ms
                       while(1); //loop till reset
@@ -521,6 +630,53 @@ void COM_commad_parse (void) {
             if (com_hex[0]<=1) menu_locked=com_hex[0];
             print_hexXX(menu_locked);
             break;
+        case 'C':
+            if (COM_getchar()!='\n') { c='\0'; break; }
+            {
+                uint8_t i;
+                print_idx(c,CONFIG_RAW_SIZE);
+                print_hexXXXX(COM_digest(COM_DIGEST_CONFIG));
+                for (i=0;i<8;i++) {
+                    print_hexXXXX(COM_digest(i));
+                }
+            }
+            break;
+#if MOTOR_LOG
+        case 'K':
+            if (COM_hex_parse(1*2)!='\0') { break; }
+            print_idx(c,com_hex[0]);
+            if (com_hex[0]<MOTOR_log_count()) {
+                // values are copied, next motor run can overwrite record before it is sent
+                motor_log_t * r=MOTOR_log_get(com_hex[0]);
+                print_hexXXXX(r->start);
+                COM_putchar(' ');
+                print_hexXXXX(r->stop);
+                COM_putchar(' ');
+                print_hexXXXX(r->pulses);
+                COM_putchar(' ');
+                print_hexXXXX(r->time);
+                COM_putchar(' ');
+                print_hexXXXX(r->diag_avg);
+                COM_putchar(' ');
+                print_hexXXXX(r->diag_peak);
+                COM_putchar(' ');
+                print_hexXX(r->pwm);
+                COM_putchar(' ');
+                print_hexXX(r->overshoot);
+                COM_putchar(' ');
+                print_hexXX(r->reason);
+            }
+            break;
+#endif
+		case 'E':
+			if (COM_getchar()=='\n') {
+				print_s_p(PSTR("E: TX "));
+				print_hexXXXX(COM_tx_overflow);
+				COM_tx_overflow=0;
+				COM_putchar('\n');
+			}
+			c='\0';
+			break;
 #endif
 		//case '\n':
 		//case '\0':
@@ -542,6 +698,18 @@ static void COM_wireless_word(uint16_t w) {
     wireless_putchar(w&0xff); 
 }
 
+/*!
+ *******************************************************************************
+ *  \brief limit block command length to table size and WL_BLOCK_MAX
+ *******************************************************************************
+ */
+static uint8_t COM_block_len(uint8_t start, uint8_t n, uint8_t size, uint8_t max) {
+    if (start>=size) return 0;
+    if (n>max) n=max;
+    if (n>size-start) n=size-start;
+    return n;
+}
+
 /*!
  *******************************************************************************
  *  \brief parse command from wireless
@@ -597,9 +765,64 @@ void COM_wireless_command_parse (uint8_t * rfm_framebuf, uint8_t rfm_framepos) {
 			if (c=='W') pos+=2;
 			pos++;
             break;
+		case 'X':
+		case 'Y':
+			// block of config_raw: X start count / Y start count data[count]
+			{
+				uint8_t start=rfm_framebuf[pos];
+				uint8_t req=rfm_framebuf[pos+1];
+				uint8_t n=COM_block_len(start,req,CONFIG_RAW_SIZE,WL_BLOCK_MAX);
+				uint8_t i;
+				pos+=2;
+				if (c=='Y') {
+					if ((uint16_t)pos+req>rfm_framepos) return; // incomplete
+					for (i=0;i<n;i++) {
+						config_raw[start+i]=rfm_framebuf[pos+i];
+						eeprom_config_save(start+i);
+					}
+					pos+=req;
+				}
+				wireless_putchar(start);
+				wireless_putchar(n);
+				for (i=0;i<n;i++) {
+					wireless_putchar(config_raw[start+i]);
+				}
+			}
+			break;
+		case 'Q':
+		case 'U':
+			// block of one ee_timers row: Q dow<<4|slot count / U dow<<4|slot count word[count]
+			{
+				uint8_t idx=rfm_framebuf[pos];
+				uint8_t req=rfm_framebuf[pos+1];
+				uint8_t dow=idx>>4;
+				uint8_t slot=idx&0xf;
+				uint8_t n=(dow<8)?COM_block_len(slot,req,RTC_TIMERS_PER_DOW,WL_BLOCK_MAX/2):0;
+				uint8_t i;
+				pos+=2;
+				if (c=='U') {
+					if ((uint16_t)pos+2*(uint16_t)req>rfm_framepos) return; // incomplete
+					for (i=0;i<n;i++) {
+						RTC_DowTimerSet(dow, slot+i,
+							(((uint16_t) (rfm_framebuf[pos+2*i])&0xf)<<8)+(uint16_t)(rfm_framebuf[pos+2*i+1]),
+							(rfm_framebuf[pos+2*i])>>4);
+					}
+					CTL_update_temp_auto();
+					pos+=2*req;
+				}
+				wireless_putchar(idx);
+				wireless_putchar(n);
+				for (i=0;i<n;i++) {
+					COM_wireless_word(eeprom_timers_read_raw(timers_get_raw_index(dow,slot+i)));
+				}
+			}
+			break;
 		case 'B':
 			{
   				if ((rfm_framebuf[pos]==0x13) && (rfm_framebuf[pos+1]==0x24)) {
+#if MOTOR_RESUME
+                      MOTOR_resume_save();
+#endif
                       cli();
                       wdt_enable(WDTO_15MS); //wd on,15ms
                       while(1); //loop till reset
@@ -622,6 +845,62 @@ void COM_wireless_command_parse (uint8_t * rfm_framebuf, uint8_t rfm_framepos) {
             wireless_putchar(menu_locked);
             pos++;
             break;
+        case 'C':
+            // digests: config size, CRC16 of config, CRC16 of timers day 0-7
+            {
+                uint8_t i;
+                wireless_putchar(CONFIG_RAW_SIZE);
+                COM_wireless_word(COM_digest(COM_DIGEST_CONFIG));
+                for (i=0;i<8;i++) {
+                    COM_wireless_word(COM_digest(i));
+                }
+            }
+            break;
+#if MOTOR_LOG
+        case 'K':
+            // motor run records from newest: K start count, reply start n record[n]
+            {
+                uint8_t start=rfm_framebuf[pos];
+                uint8_t n=COM_block_len(start,rfm_framebuf[pos+1],MOTOR_log_count(),
+                    WL_BLOCK_MAX/WL_MOTOR_LOG_RECORD);
+                pos+=2;
+                wireless_putchar(start);
+                wireless_putchar(n);
+                while (n--) {
+                    motor_log_t * r=MOTOR_log_get(start++);
+                    COM_wireless_word(r->start);
+                    COM_wireless_word(r->stop);
+                    COM_wireless_word(r->pulses);
+                    COM_wireless_word(r->time);
+                    COM_wireless_word(r->diag_avg);
+                    COM_wireless_word(r->diag_peak);
+                    wireless_putchar(r->pwm);
+                    wireless_putchar(r->overshoot);
+                    wireless_putchar(r->reason);
+                }
+            }
+            break;
+#endif
+#if OTA_UPDATE
+		case 'O':
+			// firmware delta chunk: O idx count data[count]
+			{
+				uint8_t idx=rfm_framebuf[pos];
+				uint8_t n=rfm_framebuf[pos+1];
+				pos+=2;
+				if ((uint16_t)pos+n>rfm_framepos) return; // incomplete
+				wireless_putchar(idx);
+				wireless_putchar(ota_stage(idx,rfm_framebuf+pos,n));
+				pos+=n;
+			}
+			break;
+		case 'Z':
+			// firmware delta commit: Z len_h len_l mac[4], len 0 start new update
+			wireless_putchar(ota_commit(
+				((uint16_t)rfm_framebuf[pos]<<8)+rfm_framebuf[pos+1],rfm_framebuf+pos+2));
+			pos+=6;
+			break;
+#endif
 		default:
 			break;
 		}
@@ -629,6 +908,40 @@ void COM_wireless_command_parse (uint8_t * rfm_framebuf, uint8_t rfm_framepos) {
 }
 #endif
 
+#if WL_GROUP_CMD
+/*!
+ *******************************************************************************
+ *  \brief parse group command from sync packet
+ *
+ *  \note only setting commands, there is no reply,
+ *        master gets result in next status from valve
+ *******************************************************************************
+ */
+void COM_wireless_group_parse (uint8_t * p, uint8_t len) {
+    if (len<2) return;
+    switch(p[0]) {
+        case 'A':
+            if ((p[1]<TEMP_MIN-1) || (p[1]>TEMP_MAX+1)) { break; }
+            CTL_set_temp(p[1]);
+            break;
+        case 'M':
+            CTL_change_mode(p[1]);
+            break;
+        case 'L':
+            if (p[1]<=1) menu_locked=p[1];
+            break;
+        case 'W':
+            if (len<4) { break; }
+            RTC_DowTimerSet(p[1]>>4, p[1]&0xf,
+                (((uint16_t) (p[2])&0xf)<<8)+(uint16_t)(p[3]), (p[2])>>4);
+            CTL_update_temp_auto();
+            break;
+        default:
+            break;
+    }
+}
+#endif
+
 #if DEBUG_PRINT_MOTOR
 void COM_debug_print_motor(int8_t dir, uint16_t m, uint8_t pwm) {
     if (dir>0) {
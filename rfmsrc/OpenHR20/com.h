@@ -47,6 +47,9 @@ void COM_commad_parse (void);
 #if RFM==1
     void COM_wireless_command_parse (uint8_t * rfm_framebuf, uint8_t rfm_framepos);
 #endif
+#if WL_GROUP_CMD
+    void COM_wireless_group_parse (uint8_t * p, uint8_t len);
+#endif
 
 void COM_debug_print_motor(int8_t dir, uint16_t m, uint8_t pwm);
 void COM_debug_print_temperature(uint16_t t);
@@ -220,6 +220,10 @@ In this file we define only configuration parameters, for example what kind of c
 #ifndef MOTOR_COMPENSATE_BATTERY
 	#define MOTOR_COMPENSATE_BATTERY 0
 #endif
+#ifndef MOTOR_EYE_TIMESTAMP
+	// 1 = motor eye edges are timestamped by Timer1, no Timer0 overflow interrupt
+	#define MOTOR_EYE_TIMESTAMP 0
+#endif
 #ifndef NO_AUTORETURN_FROM_ALT_MENUES
 	#define NO_AUTORETURN_FROM_ALT_MENUES 0
 #endif
@@ -240,6 +244,55 @@ In this file we define only configuration parameters, for example what kind of c
 // enable D part of PID controller
 #define CONFIG_ENABLE_D 0
 
+// valve characteristic, controller output to stroke by config.valve_curve1..7
+#ifndef VALVE_CURVE
+#define VALVE_CURVE 1
+#endif
+
+// snapshot of motor position and PID state in EEPROM on low battery and
+// controlled reset, next boot resume without calibration run
+#ifndef MOTOR_RESUME
+#define MOTOR_RESUME 1
+#endif
+
+// crystal drift estimation from wireless time sync, RTC is corrected by 1/256s
+// steps and sync packets are skipped adaptively (WL_SKIP_SYNC_MAX)
+#ifndef RTC_DRIFT
+#define RTC_DRIFT RFM
+#endif
+
+// tickless RTC, main loop sleep up to RTC_TICKLESS seconds when valve is idle
+// (timer2 interrupt only count seconds), 0 = wake up every second
+#ifndef RTC_TICKLESS
+#define RTC_TICKLESS 0
+#endif
+
+// slave RX windows shrink to learned arrival of master packets + margin,
+// never longer than WLTIME_TIMEOUT / WLTIME_SYNC_TIMEOUT
+#ifndef WL_RX_ADAPTIVE
+#define WL_RX_ADAPTIVE RFM
+#endif
+
+// group/broadcast commands (A M L W) in sync packet, membership is RFM_groups
+#ifndef WL_GROUP_CMD
+#define WL_GROUP_CMD RFM
+#endif
+
+// forward error correction of data frames, used only if config RFM_fec is set
+#ifndef WL_FEC
+#define WL_FEC RFM
+#endif
+
+// motor telemetry, records of last motor runs (see MOTOR_log_get), 0 = off
+#ifndef MOTOR_LOG
+#define MOTOR_LOG 4
+#endif
+
+// firmware update over wireless, bootloader with OTA support is required
+#ifndef OTA_UPDATE
+#define OTA_UPDATE 0
+#endif
+
 
 /* compiler compatibility */
 #ifndef ISR_NAKED
@@ -43,6 +43,7 @@
 #include "eeprom.h"
 #include "controller.h"
 #include "keyboard.h"
+#include "motor.h"
 
 // global Vars for default values: temperatures and speed
 uint8_t CTL_temp_wanted=0;   // actual desired temperature
@@ -120,6 +121,18 @@ static void CTL_window_detection(void) {
 }
 #endif
 
+#if RTC_TICKLESS
+/*!
+ *******************************************************************************
+ *  \returns count of CTL_update calls to next PID action (tickless deadline)
+ ******************************************************************************/
+uint8_t CTL_next_update(void) {
+    if (PID_force_update>=0) return PID_force_update+1;
+    if (PID_update_timeout>255) return 255;
+    return (PID_update_timeout>0)?PID_update_timeout:1;
+}
+#endif
+
 /*!
  *******************************************************************************
  *  Controller update
@@ -201,6 +214,9 @@ void CTL_update(bool minute_ch) {
     // batt error detection
     if (bat_average) {
 		if (bat_average < 20*(uint16_t)config.bat_low_thld) {
+			#if (MOTOR_RESUME)
+				if ((CTL_error & CTL_ERR_BATT_LOW) == 0) MOTOR_resume_save();
+			#endif
     	    CTL_error |=  CTL_ERR_BATT_LOW | CTL_ERR_BATT_WARNING;
 	    } else {
 	        if (bat_average < 20*(uint16_t)config.bat_warning_thld) {
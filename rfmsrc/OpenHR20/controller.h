@@ -58,6 +58,9 @@ void CTL_temp_change_inc (int8_t ch);
 #define CTL_CHANGE_MODE_REWOKE -2
 #define CTL_CLOSE_WINDOW_FORCE -3
 void CTL_change_mode(int8_t dif);
+#if RTC_TICKLESS
+uint8_t CTL_next_update(void);
+#endif
 
 #define DEFINE_INTEGRATOR_BLOCK 6
 #define I_ERR_TOLLERANCE_AROUND_0 15 // unit 0,01°C. Set it quite restrictive !
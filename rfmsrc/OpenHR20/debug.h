@@ -34,7 +34,9 @@
 #pragma once
 #include "config.h"
 
-#define DEBUG_MODE 0
+#ifndef DEBUG_MODE
+    #define DEBUG_MODE 0
+#endif
 #define DEBUG_SKIP_DATETIME_SETTING_AFTER_RESET 0
 
 
@@ -44,12 +46,23 @@
 #define KEEP_ALIVE_FOR_COMMUNICATION DEBUG_MODE
 
 #define DEBUG_PRINT_RTC_TICKS 0
-#define DEBUG_PRINT_MOTOR 0
-#define DEBUG_PRINT_MEASURE 0
-#define DEBUG_PRINT_I_SUM 1
+#ifndef DEBUG_PRINT_MOTOR
+    #define DEBUG_PRINT_MOTOR 0
+#endif
+#ifndef DEBUG_PRINT_MEASURE
+    #define DEBUG_PRINT_MEASURE 0
+#endif
+#ifndef DEBUG_PRINT_I_SUM
+    #define DEBUG_PRINT_I_SUM 1
+#endif
 #define DEBUG_PRINT_ADDITIONAL_TIMESTAMPS DEBUG_MODE
 #define DEBUG_IGNORE_MONT_CONTACT 0
-#define DEBUG_MOTOR_COUNTER  1
+#ifndef DEBUG_MOTOR_COUNTER
+    #define DEBUG_MOTOR_COUNTER  1
+#endif
+#ifndef DEBUG_WATCH
+    #define DEBUG_WATCH 1 // watch_map in watch.c, 0 = only layout is reported
+#endif
 
 #define DEBUG_BATT_ADC 0
 
@@ -117,6 +117,21 @@ typedef struct { // each variables must be uint8_t or int8_t without exception
  #endif
     /* unused */ 
 #endif
+#if VALVE_CURVE
+	/*    */ uint8_t valve_curve1; //!< valve stroke [%] for controller output 12.5%
+	/*    */ uint8_t valve_curve2; //!< valve stroke [%] for controller output 25%
+	/*    */ uint8_t valve_curve3; //!< valve stroke [%] for controller output 37.5%
+	/*    */ uint8_t valve_curve4; //!< valve stroke [%] for controller output 50%
+	/*    */ uint8_t valve_curve5; //!< valve stroke [%] for controller output 62.5%
+	/*    */ uint8_t valve_curve6; //!< valve stroke [%] for controller output 75%
+	/*    */ uint8_t valve_curve7; //!< valve stroke [%] for controller output 87.5%
+#endif
+#if WL_GROUP_CMD
+	/*    */ uint8_t RFM_groups; //!< group membership bitmask for group commands in sync packet
+#endif
+#if WL_FEC
+	/*    */ uint8_t RFM_fec; //!< 1 = data frames with forward error correction
+#endif
 
 } config_t;
 
@@ -124,10 +139,15 @@ extern config_t config;
 #define config_raw ((uint8_t *) &config)
 #define kx_d ((uint8_t *) &config.temp_cal_table0)
 #define temperature_table ((uint8_t *) &config.temperature0)
+#define valve_curve ((uint8_t *) &config.valve_curve1)
+#define VALVE_CURVE_N 8 //!< segments of valve_curve, points 0% and 100% are fixed
 #define CONFIG_RAW_SIZE (sizeof(config_t))
 
 extern uint16_t EEPROM ee_timers[8][RTC_TIMERS_PER_DOW];
 extern uint8_t EEPROM ee_layout;
+extern uint8_t EEPROM ee_reserved2_60[60];
+#define EE_RESUME ((uint16_t)ee_reserved2_60) //!< MOTOR_resume_save() snapshot, 0xff = empty
+#define EE_RCO (EE_RESUME+50) //!< calibrate_rco() OSCCAL per temperature (10 bytes), 0xff = unknown
 
 // Boot Timeslots -> move to CONFIG.H
 // 10 Minutes after BOOT_hh:00
@@ -136,10 +156,23 @@ extern uint8_t EEPROM ee_layout;
 #define BOOT_ON2      (16*60+0x2000) //!<  16:00
 #define BOOT_OFF2     (21*60+0x1000) //!<  21:00
 
-#if (HW_WINDOW_DETECTION)
-#define EE_LAYOUT (0x15) 
+// valve_curve, RFM_groups and RFM_fec are new in 0x16/0x17,
+// RFM_groups and RFM_fec are in RFM builds only (as RFM_devaddr in 0x14/0x15)
+#if (VALVE_CURVE) && (WL_GROUP_CMD == RFM) && (WL_FEC == RFM)
+ #if (HW_WINDOW_DETECTION)
+  #define EE_LAYOUT (0x17) 
+ #else
+  #define EE_LAYOUT (0x16) 
+ #endif
+#elif !(VALVE_CURVE) && !(WL_GROUP_CMD) && !(WL_FEC)
+ #if (HW_WINDOW_DETECTION)
+  #define EE_LAYOUT (0x15) 
+ #else
+  #define EE_LAYOUT (0x14) 
+ #endif
 #else
-#define EE_LAYOUT (0x14) 
+	#define EE_LAYOUT (0xff) 
+	// for this options we haven't reserved EE_LAYOUT number yet
 #endif
 #if (BOOST_CONTROLER_AFTER_CHANGE) || (TEMP_COMPENSATE_OPTION)
 	#define EE_LAYOUT (0xff) 
@@ -283,6 +316,22 @@ uint8_t EEPROM ee_config[][4] ={  // must be alligned to 4 bytes
   /*    */  {RFM_TUNING_MODE, 0, 0x00, 0x01},   //!< RFM12 tuning mode, 0 = tuning mode off (narrow, high data rate), 1 = tuning mode on (wide, low data rate)
  #endif
 #endif
+#if VALVE_CURVE
+  // default is linear, valvefit.php fit it from log, must be rising
+  /*    */  {13,         13,        0,      100},   //!< valve_curve1; stroke for output 12.5%
+  /*    */  {25,         25,        0,      100},   //!< valve_curve2; stroke for output 25%
+  /*    */  {38,         38,        0,      100},   //!< valve_curve3; stroke for output 37.5%
+  /*    */  {50,         50,        0,      100},   //!< valve_curve4; stroke for output 50%
+  /*    */  {63,         63,        0,      100},   //!< valve_curve5; stroke for output 62.5%
+  /*    */  {75,         75,        0,      100},   //!< valve_curve6; stroke for output 75%
+  /*    */  {88,         88,        0,      100},   //!< valve_curve7; stroke for output 87.5%
+#endif
+#if WL_GROUP_CMD
+  /*    */  {0,           0,        0,      255},   //!< RFM_groups; group membership bitmask, broadcast (group 0) is accepted always
+#endif
+#if WL_FEC
+  /*    */  {0,           0,        0,      1},     //!< RFM_fec; 1 = data frames with FEC, master follows automatically
+#endif
 };
 
 #endif //__EEPROM_C__
@@ -23,7 +23,7 @@ sleep 3
 #flash files from current dir
 if [ $SETFUSES -eq 1 ]; then
 	echo "*** setting fuses..."
-	$DUDE -U hfuse:w:0x9B:m -U lfuse:w:0xE2:m
+	$DUDE -U hfuse:w:0x99:m -U lfuse:w:0xE2:m # BOOTSZ=00, 2KB boot section, see ../common/flash_layout.h
 	sleep 3
 fi
 echo "*** writing openhr20 flash and eeprom..."
@@ -47,54 +47,52 @@
 
 // global Vars for keypress and wheel status
 static uint8_t state_front_prev;
-uint8_t state_wheel_prev;
+uint8_t state_wheel_prev;          // owned by PCINT1 ISR after init
 static uint8_t long_press;
 static uint8_t long_quiet;
-static volatile uint8_t keys = 0;  // must be volatile, shared into interrupt
 uint16_t kb_events = 0;
+int8_t kb_wheel = 0;               // wheel steps not consumed by menu yet
 volatile bool kb_timeout = true;
 static bool allow_rewoke = false; 
 
+/*
+ * event ring, single producer (PCINT1 ISR) / single consumer (task_keyboard)
+ * head is written only by ISR, tail only by main loop, no locking needed
+ */
+static kb_ring_t kb_ring[KB_RING_SIZE];
+static volatile uint8_t kb_ring_head = 0;
+static volatile uint8_t kb_ring_tail = 0;
+#if HAVE_WHEEL
+static uint8_t wheel_time;         // TCNT2 of last accepted wheel step
+static volatile uint8_t wheel_age; // 1s ticks since wheel_time, saturated at 2
+#endif
+
 
 /*!
  *******************************************************************************
- *  Recognize keypress and wheel
+ *  Process keypress and wheel events from ISR ring
  *
- *  \note
+ *  \note wheel steps are accumulated in kb_wheel, nothing is lost when
+ *        menu is processed later than wheel is rotated
  ******************************************************************************/
 
 void task_keyboard(void) {
-
- 
+ while (kb_ring_tail != kb_ring_head) {
+	kb_ring_t *e = &kb_ring[kb_ring_tail];
 #if HAVE_WHEEL
- {	// wheel
-	uint8_t wheel= keys & (KBI_ROT1 | KBI_ROT2);
-	if ((wheel ^ state_wheel_prev) & KBI_ROT1) {	//only ROT1 have interrupt, change detection
-		if ((wheel == 0) || (wheel == (KBI_ROT1|KBI_ROT2))) {
-#ifdef LCD_UPSIDE_DOWN
+	if (e->wheel != 0) {	// wheel
+		if (e->wheel > 0) {
+			if (kb_wheel < KB_WHEEL_MAX) kb_wheel++;
 			kb_events |= KB_EVENT_WHEEL_PLUS;
-#else
-			kb_events |= KB_EVENT_WHEEL_MINUS;
-#endif
-			long_quiet = 0;
 		} else {
-#ifdef LCD_UPSIDE_DOWN
+			if (kb_wheel > -KB_WHEEL_MAX) kb_wheel--;
 			kb_events |= KB_EVENT_WHEEL_MINUS;
-#else
-			kb_events |= KB_EVENT_WHEEL_PLUS;
-#endif
-			long_quiet = 0;
 		}
-		state_wheel_prev = wheel;
-	}
- } // wheel
+		long_quiet = 0;
+	} else
 #endif
  { // other keys
-#if HAVE_WHEEL
- 	uint8_t front = keys & ( KBI_PROG | KBI_C | KBI_AUTO);
-#else
- 	uint8_t front = keys & ( KBI_PROG | KBI_C | KBI_AUTO | KBI_ROT1 | KBI_ROT2);
-#endif
+ 	uint8_t front = e->front;
 	if (front != state_front_prev) {
 		if (front && (state_front_prev == 0) && kb_timeout) {
 			if (front == KBI_PROG) {
@@ -109,8 +107,10 @@ void task_keyboard(void) {
 #if HAVE_WHEEL == 0
 			} else if (front == KBI_ROT1) {
 				kb_events |= KB_EVENT_WHEEL_MINUS;
+				if (kb_wheel > -KB_WHEEL_MAX) kb_wheel--;
 			} else if (front == KBI_ROT2) {
 				kb_events |= KB_EVENT_WHEEL_PLUS;
+				if (kb_wheel < KB_WHEEL_MAX) kb_wheel++;
 #endif
 			}
 		}
@@ -132,16 +132,21 @@ void task_keyboard(void) {
     		}
     	}
 		if (kb_timeout) { // keyboard noise cancellation
+            // window starts at event time, not at time of processing
+            uint8_t t = e->time + KEYBOARD_NOISE_CANCELATION;
+            if ((uint8_t)(t - TCNT2) > KEYBOARD_NOISE_CANCELATION) {
+                t = TCNT2 + 2; // already expired, finish it soon
+            }
             kb_timeout = false;
             // while (ASSR & (1<<OCR2UB)) {;} //this is not needed; kb_timeout==true means that OCR2A must be free
-            RTC_timer_set(RTC_TIMER_KB,TCNT2 + KEYBOARD_NOISE_CANCELATION);
+            RTC_timer_set(RTC_TIMER_KB, t);
         }
-        state_front_prev = front;
-
         state_front_prev = front;
 		long_press = 0; // long press detection RESET
 		long_quiet = 0;
 	} 
+ }
+	kb_ring_tail = (kb_ring_tail + 1) & (KB_RING_SIZE - 1);
  }
 }
 
@@ -153,6 +158,11 @@ void task_keyboard(void) {
  ******************************************************************************/
 
 void task_keyboard_long_press_detect(void) {
+#if HAVE_WHEEL
+	cli();
+	if (wheel_age<2) wheel_age++;
+	sei();
+#endif
 	if (! state_front_prev) {
 		if (++long_quiet == 0) {
 			// overload protection, nothing to do, event was generated previous
@@ -193,6 +203,16 @@ void task_keyboard_long_press_detect(void) {
 	} //if (! state_front_prev)
 }
 
+#if RTC_TICKLESS
+/*!
+ *******************************************************************************
+ *  \returns true while any key is pressed (long press is measured)
+ ******************************************************************************/
+bool task_keyboard_pressed(void) {
+	return state_front_prev!=0;
+}
+#endif
+
 /*!
  *******************************************************************************
  * Update mont contact status
@@ -230,15 +250,35 @@ bool mont_contact_pooling(void){
 }
 
 
+/*!
+ *******************************************************************************
+ * store event to ring, called from ISR only
+ *
+ * \returns false if ring is full (event is lost)
+ ******************************************************************************/
+static inline bool kb_ring_put(int8_t wheel, uint8_t front, uint8_t time) {
+	uint8_t head = kb_ring_head;
+	uint8_t next = (head + 1) & (KB_RING_SIZE - 1);
+	if (next == kb_ring_tail) return false;
+	kb_ring[head].wheel = wheel;
+	kb_ring[head].front = front;
+	kb_ring[head].time = time;
+	kb_ring_head = next;
+	task |= TASK_KB;
+	return true;
+}
+
 /*!
  *******************************************************************************
  * Interrupt Routine
  *
- *  - create task for keyboard scan and wake up
- *  - read keyboard status
+ *  - decode wheel and debounce it by time
+ *  - put timestamped event to ring
+ *  - create task for keyboard only when new event is stored
  ******************************************************************************/
 ISR(PCINT1_vect) {
 	static uint8_t pinb_last;
+	static uint8_t front_last;
 	uint8_t pinb = PINB;
 
 	enable_rot2_input();
@@ -247,10 +287,44 @@ ISR(PCINT1_vect) {
 	asm volatile ("nop");
 
 	if ((PCMSK1 & KBI_ALL) && ((((pinb ^ pinb_last) & KBI_ALL)) != 0)) {
-			task |= TASK_KB;
-			keys = ~PINB & KBI_ALL;
-      // low active
-
+		uint8_t keys = ~PINB & KBI_ALL; // low active
+		uint8_t t = TCNT2;
+		int8_t wheel_step = 0;
+#if HAVE_WHEEL
+		uint8_t wheel = keys & (KBI_ROT1 | KBI_ROT2);
+		if ((wheel ^ state_wheel_prev) & KBI_ROT1) {	//only ROT1 have interrupt, change detection
+			// contact bounce: state is tracked, but no event inside debounce time
+			// TCNT2 wraps every second, wheel_age extends it after idle
+			if ((wheel_age>=2) || ((wheel_age==1) && (t>=wheel_time))
+					|| ((uint8_t)(t - wheel_time) >= KB_WHEEL_DEBOUNCE)) {
+				if ((wheel == 0) || (wheel == (KBI_ROT1|KBI_ROT2))) {
+#ifdef LCD_UPSIDE_DOWN
+					wheel_step = 1;
+#else
+					wheel_step = -1;
+#endif
+				} else {
+#ifdef LCD_UPSIDE_DOWN
+					wheel_step = -1;
+#else
+					wheel_step = 1;
+#endif
+				}
+				wheel_time = t;
+				wheel_age = 0;
+			}
+			state_wheel_prev = wheel;
+		}
+		uint8_t front = keys & ( KBI_PROG | KBI_C | KBI_AUTO);
+#else
+		uint8_t front = keys & ( KBI_PROG | KBI_C | KBI_AUTO | KBI_ROT1 | KBI_ROT2);
+#endif
+		if (wheel_step != 0) {
+			kb_ring_put(wheel_step, front_last, t);
+		}
+		if (front != front_last) {
+			if (kb_ring_put(0, front, t)) front_last = front;
+		}
 	}
 
 	disable_rot2_input();
@@ -34,6 +34,7 @@
 #pragma once
 
 extern uint16_t kb_events;
+extern int8_t kb_wheel;
 
 #define KB_EVENT_WHEEL_PLUS		(1 << 0)
 #define KB_EVENT_WHEEL_MINUS	(1 << 1)
@@ -56,6 +57,31 @@ extern uint16_t kb_events;
 #define LONG_QUIET_THLD 60
 
 #define KEYBOARD_NOISE_CANCELATION 50 //!< unit is 1/256s depend to RTC
+#define KB_WHEEL_DEBOUNCE 2 //!< unit is 1/256s, ROT1 edges closer than this are contact bounce
+#define KB_WHEEL_MAX 7 //!< limit of accumulated wheel steps for one menu call
+
+/*!
+ *  x modulo m in 0..m-1 also for negative x, wheel steps (up to
+ *  -KB_WHEEL_MAX) can be more than range of menu value
+ */
+static inline int16_t kb_wheel_wrap(int16_t x, int16_t m) {
+    x%=m;
+    return (x<0)?(x+m):x;
+}
+
+//! value v changed by wheel steps, wrap around inside min..max
+static inline uint8_t kb_wheel_range(uint8_t v, int8_t wheel, uint8_t min, uint8_t max) {
+    return (uint8_t)(kb_wheel_wrap((int16_t)v+wheel-min,(int16_t)max-min+1)+min);
+}
+
+#define KB_RING_SIZE 8 //!< must be power of 2
+
+//! keyboard event, stored by PCINT1 ISR
+typedef struct {
+	int8_t wheel;   //!< wheel step +1/-1, 0 for key change
+	uint8_t front;  //!< pressed front keys (KBI_*) after event
+	uint8_t time;   //!< RTC_s256 (TCNT2) at event
+} kb_ring_t;
 
 // names for keys
 #if ZERO
@@ -85,6 +111,9 @@ extern uint16_t kb_events;
 extern uint8_t state_wheel_prev;
 void task_keyboard(void);
 void task_keyboard_long_press_detect(void);
+#if RTC_TICKLESS
+bool task_keyboard_pressed(void);
+#endif
 bool mont_contact_pooling(void);
 
 #if ZERO
@@ -74,6 +74,9 @@
 // prototypes
 int main(void);                            // main with main loop
 static inline void init(void);                           // init the whole thing
+#if RTC_TICKLESS
+static uint8_t tickless_seconds(void);
+#endif
 void load_defauls(void);                   // load default values
                                            // (later from eeprom using config.c)
 void callback_settemp(uint8_t);            // called from RTC to set new reftemp
@@ -195,6 +198,9 @@ int __attribute__ ((noreturn)) main(void)
         // communication
 		if (task & TASK_COM) {
 			task&=~TASK_COM;
+			#if RTC_TICKLESS
+				RTC_sleep=1;
+			#endif
 			COM_commad_parse();
 			continue; // on most case we have only 1 task, improve time to sleep
 		}
@@ -219,7 +225,21 @@ int __attribute__ ((noreturn)) main(void)
 			#endif
             if (RTC_timer_done&_BV(RTC_TIMER_RTC))
             {
+                #if RTC_TICKLESS
+                    // catch up slept seconds, minute change is never slept over
+                    uint8_t n;
+                    cli(); n=RTC_pending; RTC_pending=0; sei();
+                    ADC_seconds=(n>0)?n:1;
+                    for (;n>1;n--) {
+                        RTC_AddOneSecond();
+                        CTL_update(false);
+                        task_keyboard_long_press_detect();
+                    }
+                #endif
                 RTC_AddOneSecond();
+                #if RTC_DRIFT
+                    RTC_DriftApply();
+                #endif
             }
             if (RTC_timer_done&(_BV(RTC_TIMER_OVF)|_BV(RTC_TIMER_RTC)))
             {
@@ -251,6 +271,14 @@ int __attribute__ ((noreturn)) main(void)
                     #if RFM
                         wirelesTimeSyncCheck();
                     #endif
+                    #if HAS_CALIBRATE_RCO
+                        // RC oscillator drift with temperature
+                        if (!timer0_need_clock() && !RS_need_clock()
+                        #if RFM
+                            && (rfm_mode==rfmmode_stop)
+                        #endif
+                            ) calibrate_rco(temp_average);
+                    #endif
                 }
                 #if RFM
     				if ((config.RFM_devaddr!=0)
@@ -301,6 +329,9 @@ int __attribute__ ((noreturn)) main(void)
                     menu_auto_update_timeout--;
                 }
                 menu_view(false); // TODO: move it, it is wrong place
+                #if RTC_TICKLESS
+                    RTC_sleep=tickless_seconds();
+                #endif
             }
             #if RFM
               if (RTC_timer_done&_BV(RTC_TIMER_RFM))
@@ -314,6 +345,9 @@ int __attribute__ ((noreturn)) main(void)
 
 		// menu state machine
 		if (kb_events || (menu_auto_update_timeout==0)) {
+			#if RTC_TICKLESS
+				RTC_sleep=1;
+			#endif
            bool update = menu_controller(false);
            if (update) {
                menu_controller(true); // menu updated, call it again
@@ -349,6 +383,42 @@ FUSES =
 };
 #endif
 
+#if RTC_TICKLESS
+/*!
+ *******************************************************************************
+ * seconds to next deadline of main loop
+ *
+ * \note deadlines: minute change (timers, CTL_update(true)), PID action,
+ *       radio slot; motor run, menu (incl. clock screen and LCD blink),
+ *       COM and startup need every second
+ ******************************************************************************/
+static uint8_t tickless_seconds(void) {
+    uint8_t s = 60-RTC_GetSecond();
+    uint8_t t;
+    if ((MOTOR_Dir!=stop) || !MOTOR_IsCalibrated() || !menu_idle()
+        || task_keyboard_pressed() || (bat_average==0) || RS_need_clock()) return 1;
+    t = CTL_next_update();
+    if (t<s) s=t;
+    #if RFM
+        if (config.RFM_devaddr!=0) {
+            uint8_t ss = RTC_GetSecond();
+            if ((time_sync_tmo<=1) || (wl_force_addr1==config.RFM_devaddr)
+                || (wl_force_addr2==config.RFM_devaddr)
+                || ((wl_force_addr1==0xff) && ((wl_force_flags>>config.RFM_devaddr)&1))) return 1;
+            // sync on second 29 and 59
+            t = (ss<29)?(29-ss):((ss<59)?(59-ss):30);
+            if (t<s) s=t;
+            // own slot
+            if (wireless_buf_ptr) {
+                t = (config.RFM_devaddr+60-ss)%60;
+                if ((t!=0) && (t<s)) s=t;
+            }
+        }
+    #endif
+    return (s>RTC_TICKLESS)?RTC_TICKLESS:s;
+}
+#endif
+
 /*!
  *******************************************************************************
  * Initialize all modules
@@ -366,8 +436,7 @@ static inline void init(void)
 
 
 
-    //! Calibrate the internal RC Oszillator
-    //! \todo test calibrate_rco();
+    //! internal RC Oszillator is calibrated from main loop, temperature is needed
 
     //! set Clock to 4 Mhz
     CLKPR = (1<<CLKPCE);            // prescaler change enable
@@ -455,6 +524,9 @@ static inline void init(void)
 
     //! Initialize the motor
     MOTOR_Init();
+#if MOTOR_RESUME
+    MOTOR_resume_load();
+#endif
 
     //1 Initialize the LCD
     LCD_Init();
@@ -61,7 +61,13 @@ void delay(uint16_t);                   // delay
 extern bool mode_auto;
 
 
-#define power_up_ADC() (PRR = (1<<PRTIM1)|(1<<PRSPI))  
-#define power_down_ADC() (PRR = (1<<PRTIM1)|(1<<PRSPI)|(1<<PRADC))  
+#if MOTOR_EYE_TIMESTAMP
+// keep Timer1 powered while motor eye use it
+#define PRR_TIM1 ((TCCR1B & ((1<<CS12)|(1<<CS11)|(1<<CS10)))?0:(1<<PRTIM1))
+#else
+#define PRR_TIM1 (1<<PRTIM1)
+#endif
+#define power_up_ADC() (PRR = PRR_TIM1|(1<<PRSPI))  
+#define power_down_ADC() (PRR = PRR_TIM1|(1<<PRSPI)|(1<<PRADC))  
 
 #endif /* MAIN_H */
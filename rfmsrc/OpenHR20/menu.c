@@ -93,12 +93,8 @@ uint32_t hourbar_buff;
  ******************************************************************************/
 
 static int8_t wheel_proccess(void) {
-    int8_t ret=0;
-    if (kb_events & KB_EVENT_WHEEL_PLUS) {
-        ret= 1;
-    } else if (kb_events & KB_EVENT_WHEEL_MINUS) {
-        ret= -1;
-    } 
+    int8_t ret=kb_wheel; // all steps since last call, not only one
+    kb_wheel=0;
     return ret;
 }
 
@@ -295,7 +291,7 @@ bool menu_controller(bool new_state) {
         menu_state = menu_set_timmer_dow;
         // do not use break here
     case menu_set_timmer_dow:
-        if (wheel != 0) menu_set_dow=(menu_set_dow+wheel+8)%8;
+        if (wheel != 0) menu_set_dow=kb_wheel_wrap(menu_set_dow+wheel,8);
         if ( kb_events & KB_EVENT_PROG ) {
             menu_state=menu_set_timmer;
             menu_set_slot=0;
@@ -315,7 +311,7 @@ bool menu_controller(bool new_state) {
             if (menu_set_time>24*60) menu_set_time=24*60;
         }
         if (wheel != 0) {
-            menu_set_time=((menu_set_time/10+(24*6+1)+wheel)%(24*6+1))*10;
+            menu_set_time=kb_wheel_wrap(menu_set_time/10+wheel,24*6+1)*10;
         }
         if ( kb_events & KB_EVENT_C ) {
             menu_set_mode=(menu_set_mode+5)%4;
@@ -379,13 +375,11 @@ bool menu_controller(bool new_state) {
         } else {
             if (menu_state == menu_service1) {
                 // change index
-                service_idx = (service_idx+wheel+CONFIG_RAW_SIZE)%CONFIG_RAW_SIZE;
+                service_idx = kb_wheel_wrap(service_idx+wheel,CONFIG_RAW_SIZE);
             } else {
                 // change value in RAM, to save press PROG
-                int16_t min = (int16_t)config_min(service_idx);
-                int16_t max_min_1 = (int16_t)(config_max(service_idx))-min+1;
-                config_raw[service_idx] = (uint8_t) (
-                        ((int16_t)(config_raw[service_idx])+(int16_t)wheel-min+max_min_1)%max_min_1+min);
+                config_raw[service_idx] = kb_wheel_range(config_raw[service_idx],wheel,
+                        config_min(service_idx),config_max(service_idx));
                 if (service_idx==0) LCD_Init();
             }
         }
@@ -398,7 +392,9 @@ bool menu_controller(bool new_state) {
             menu_state=menu_service1; 
             ret=true;
         } else {
-            service_watch_n=(service_watch_n+wheel+WATCH_N)%WATCH_N;
+#if WATCH_N
+            service_watch_n=kb_wheel_wrap(service_watch_n+wheel,WATCH_N);
+#endif
             if (wheel != 0) ret=true;
         }
         break;
@@ -413,6 +409,18 @@ bool menu_controller(bool new_state) {
     return ret;
 } 
 
+/*!
+ *******************************************************************************
+ * \returns true on home screen without running timeout
+ *
+ * \note clock screen (menu_home4) and blinking LCD need update every second
+ ******************************************************************************/
+bool menu_idle(void) {
+    return (menu_state>=menu_home_no_alter) && (menu_state<menu_lock)
+        && (menu_state!=menu_home4) && (LCD_used_bitplanes==1)
+        && (menu_auto_update_timeout<0);
+}
+
 /*!
  *******************************************************************************
  * view helper funcions for clear display
@@ -36,6 +36,7 @@
 extern int8_t menu_auto_update_timeout;
 bool menu_controller(bool new_state); 
 void menu_view(bool update);
+bool menu_idle(void);
 
 extern bool menu_locked; 
 
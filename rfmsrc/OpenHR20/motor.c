@@ -39,6 +39,7 @@
 #include <avr/pgmspace.h>
 #include <avr/sleep.h>
 #include <avr/version.h>
+#include <util/crc16.h>
 
 
 // HR20 Project includes
@@ -70,7 +71,11 @@ static volatile motor_dir_t MOTOR_Dir_Counter;  //!< actual direction for count
 // bool MOTOR_Mounted;         //!< mountstatus true: if valve is mounted
 int8_t MOTOR_calibration_step=-2; // not calib$rated
 volatile uint16_t motor_diag = 0;
+#if MOTOR_EYE_TIMESTAMP
+static volatile uint16_t motor_pulse_time;  //!< Timer1 at last counted pulse
+#else
 static volatile uint16_t motor_diag_cnt = 0;
+#endif
 
 static volatile uint16_t motor_max_time_for_impulse;
 
@@ -82,8 +87,168 @@ static volatile uint16_t longest_low_eye = 0;
 
 static void MOTOR_Control(motor_dir_t); // control H-bridge of motor
 
+#if MOTOR_LOG
+static motor_log_t motor_log[MOTOR_LOG];
+static uint8_t motor_log_head = 0;         //!< next record
+static uint8_t motor_log_n = 0;            //!< valid records
+static bool motor_log_open = false;        //!< run in progress
+static int16_t motor_log_start;
+static volatile uint16_t motor_log_pulses;
+static volatile uint32_t motor_log_sum;
+static volatile uint32_t motor_log_sum_run;   //!< sum without start-up impulses
+static volatile uint16_t motor_log_peak;
+static volatile bool motor_log_timeout;
+
+/*!
+ *******************************************************************************
+ *  close record of motor run
+ *
+ *  \param reason MOTOR_LOG_REACHED ... MOTOR_LOG_ABORT
+ ******************************************************************************/
+static void MOTOR_log_end(uint8_t reason) {
+    motor_log_t * r = &motor_log[motor_log_head];
+    uint16_t pulses;
+    uint32_t sum;
+    uint32_t sum_run;
+    if (!motor_log_open) return;
+    cli();
+    pulses = motor_log_pulses;
+    sum = motor_log_sum;
+    sum_run = motor_log_sum_run;
+    r->diag_peak = motor_log_peak;
+    sei();
+    r->start = motor_log_start;
+    r->stop = MOTOR_PosAct;
+    r->pulses = pulses;
+    r->time = (uint16_t)((sum+128)>>8);
+    r->diag_avg = (pulses>MOTOR_IGNORE_IMPULSES)
+        ?(uint16_t)(sum_run/(pulses-MOTOR_IGNORE_IMPULSES)):0;
+    r->pwm = OCR0A;
+    r->overshoot = MOTOR_PosOvershoot;
+    r->reason = reason;
+    motor_log_head = (motor_log_head+1)%MOTOR_LOG;
+    if (motor_log_n < MOTOR_LOG) motor_log_n++;
+    motor_log_open = false;
+}
+
+/*!
+ *******************************************************************************
+ *  open record of motor run, previous one is closed as aborted
+ ******************************************************************************/
+static void MOTOR_log_begin(void) {
+    MOTOR_log_end(motor_log_timeout?MOTOR_LOG_TIMEOUT:MOTOR_LOG_ABORT);
+    motor_log_start = MOTOR_PosAct;
+    cli();
+    motor_log_pulses = 0;
+    motor_log_sum = 0;
+    motor_log_sum_run = 0;
+    motor_log_peak = 0;
+    motor_log_timeout = false;
+    sei();
+    motor_log_open = true;
+}
+
+/*!
+ *******************************************************************************
+ *  \returns number of valid records
+ ******************************************************************************/
+uint8_t MOTOR_log_count(void) {
+    return motor_log_n;
+}
+
+/*!
+ *******************************************************************************
+ *  \param idx record index, 0 is newest
+ *  \returns record, idx must be < MOTOR_log_count()
+ ******************************************************************************/
+motor_log_t * MOTOR_log_get(uint8_t idx) {
+    return &motor_log[(uint8_t)(motor_log_head+MOTOR_LOG-1-idx)%MOTOR_LOG];
+}
+#endif
+
 static uint8_t MOTOR_wait_for_new_calibration = 5;
 
+#if MOTOR_RESUME
+//! snapshot in EEPROM, change RESUME_MAGIC if structure is changed
+typedef struct {
+    uint8_t magic;          //!< RESUME_MAGIC, written as last byte
+    uint8_t crc;            //!< crc8 of rest
+    int16_t pos_act;        //!< MOTOR_PosAct
+    int16_t pos_max;        //!< MOTOR_PosMax
+    int32_t sum_error;      //!< sumError
+    int8_t credit;          //!< CTL_interatorCredit
+    uint8_t expiration;     //!< CTL_creditExpiration
+    uint8_t valve[VALVE_HISTORY_LEN]; //!< valveHistory
+} motor_resume_t;
+
+#define RESUME_MAGIC 0xa1
+
+static uint8_t MOTOR_resume_crc(uint8_t *p) {
+    uint8_t crc = 0;
+    uint8_t i;
+    for (i=2; i<sizeof(motor_resume_t); i++) {
+        crc = _crc_ibutton_update(crc, p[i]);
+    }
+    return crc;
+}
+
+static void MOTOR_resume_write(uint8_t i, uint8_t data) {
+    if (EEPROM_read(EE_RESUME+i) != data) EEPROM_write(EE_RESUME+i, data);
+}
+
+/*!
+ *******************************************************************************
+ *  store motor position, calibration and PID state
+ *
+ *  \note brownout safe: magic is invalidated before motor start and written
+ *        after all data, crc catch interrupted write
+ ******************************************************************************/
+void MOTOR_resume_save(void) {
+    motor_resume_t r;
+    uint8_t i;
+    if (!MOTOR_IsCalibrated() || (MOTOR_Dir != stop)) return;
+    r.pos_act = MOTOR_PosAct;
+    r.pos_max = MOTOR_PosMax;
+    r.sum_error = sumError;
+    r.credit = CTL_interatorCredit;
+    r.expiration = CTL_creditExpiration;
+    for (i=0; i<VALVE_HISTORY_LEN; i++) r.valve[i] = valveHistory[i];
+    r.crc = MOTOR_resume_crc((uint8_t *)&r);
+    for (i=1; i<sizeof(motor_resume_t); i++) {
+        MOTOR_resume_write(i, ((uint8_t *)&r)[i]);
+    }
+    MOTOR_resume_write(0, RESUME_MAGIC);
+}
+
+/*!
+ *******************************************************************************
+ *  restore snapshot on boot, it is used only once
+ *
+ *  \note must be called after MOTOR_Init(); unmounted valve is detected
+ *        later by MOTOR_updateCalibration(0) and it force new calibration
+ ******************************************************************************/
+void MOTOR_resume_load(void) {
+    motor_resume_t r;
+    uint8_t i;
+    for (i=0; i<sizeof(motor_resume_t); i++) {
+        ((uint8_t *)&r)[i] = EEPROM_read(EE_RESUME+i);
+    }
+    if (r.magic != RESUME_MAGIC) return;
+    MOTOR_resume_write(0, 0); // used once, next boot calibrate again
+    if ((r.crc != MOTOR_resume_crc((uint8_t *)&r))
+        || (r.pos_max < MOTOR_MIN_IMPULSES) || (r.pos_max > MOTOR_MAX_IMPULSES)
+        || (r.pos_act < 0) || (r.pos_act > r.pos_max)
+        || (r.credit > (int8_t)config.I_max_credit)) return;
+    MOTOR_PosAct = r.pos_act;
+    MOTOR_PosMax = r.pos_max;
+    MOTOR_calibration_step = 0;
+    sumError = r.sum_error;
+    CTL_interatorCredit = r.credit;
+    CTL_creditExpiration = r.expiration;
+    for (i=0; i<VALVE_HISTORY_LEN; i++) valveHistory[i] = r.valve[i];
+}
+#endif
+
 
 /*!
  *******************************************************************************
@@ -152,6 +317,22 @@ uint8_t MOTOR_GetPosPercent(void)
 
 volatile uint8_t MOTOR_PosOvershoot=0; // detected motor overshoot 
 
+#if VALVE_CURVE
+/*!
+ *******************************************************************************
+ * valve characteristic, linear interpolation of valve_curve
+ * \param  percent controller output 1-99
+ * \returns stroke in 1/1000 of MOTOR_PosMax
+ ******************************************************************************/
+static uint16_t MOTOR_valve_curve(uint8_t percent) {
+    uint16_t x = (uint16_t)percent * VALVE_CURVE_N;  // 100 per segment
+    uint8_t k = x / 100;
+    int16_t y0 = (k==0) ? 0 : valve_curve[k-1];
+    int16_t y1 = (k>=VALVE_CURVE_N-1) ? 100 : valve_curve[k];
+    return (uint16_t)(y0*10 + ((y1-y0) * (int16_t)(x % 100)) / 10);
+}
+#endif
+
 /*!
  *******************************************************************************
  * drive motor to desired position in percent
@@ -171,11 +352,15 @@ void MOTOR_Goto(uint8_t percent)
         } else if (percent == 0) {
             MOTOR_PosStop = 0;
         } else {
+#if VALVE_CURVE
+            MOTOR_PosStop = (int16_t)(((int32_t)MOTOR_valve_curve(percent) * MOTOR_PosMax) / 1000);
+#else
             // MOTOR_PosMax>>2 and 100>>2 => overload protection
             #if (MOTOR_MAX_IMPULSES>>2)*(100>>2) > INT16_MAX
              #error variable OVERLOAD possible
             #endif
             MOTOR_PosStop = ((int16_t)percent * (MOTOR_PosMax>>2)) / (100>>2);
+#endif
         }
         // switch motor on
         {
@@ -206,6 +391,23 @@ static void MOTOR_pwm_set(int16_t pwm) {
 static uint8_t motor_diag_ignore=MOTOR_IGNORE_IMPULSES;
 static uint8_t pine_last=0;
 
+#if MOTOR_EYE_TIMESTAMP
+/*!
+ *******************************************************************************
+ * Set Timer1 compare to nearest deadline from last counted pulse
+ *  - motor_timer > 0: no pulse for motor_timer ticks => motor stall
+ *  - motor_close_eye_timeout: switch off photo eye and Timer0
+ *
+ * \note Timer1 ticks are clk/256, same as Timer0 overflows in legacy mode
+ ******************************************************************************/
+static void MOTOR_set_deadline(void) {
+    uint16_t t = (uint16_t)config.motor_close_eye_timeout<<8;
+    if ((motor_timer > 0) && (motor_timer < t)) t = motor_timer;
+    OCR1A = motor_pulse_time + t;
+    TIFR1 = (1<<OCF1A); // clean interrupt flag
+}
+#endif
+
 /*!
  *******************************************************************************
  * control motor movement
@@ -232,8 +434,22 @@ static void MOTOR_Control(motor_dir_t direction) {
         MOTOR_Dir = stop;
     } else {                                            // motor on
         if (MOTOR_Dir != direction){
+#if MOTOR_LOG
+            MOTOR_log_begin();
+#endif
+#if MOTOR_RESUME
+            MOTOR_resume_write(0, 0); // position will change, snapshot is invalid
+#endif
             MOTOR_eye_enable();
+#if MOTOR_EYE_TIMESTAMP
+            PRR &= ~(1<<PRTIM1); // timer1 power on
+            TCCR1A = 0;
+            TCCR1B = (1<<CS12); // clk/256, free running
+            motor_pulse_time = last_eye_change = TCNT1;
+            longest_low_eye = 0;
+#else
             motor_diag_cnt=0; last_eye_change=0; longest_low_eye = 0; 
+#endif
             motor_diag_ignore = MOTOR_IGNORE_IMPULSES;
             MOTOR_Dir_Counter = (MOTOR_Dir = direction);
             motor_max_time_for_impulse = ((uint16_t)config.motor_speed *
@@ -241,9 +457,14 @@ static void MOTOR_Control(motor_dir_t direction) {
                             (uint16_t)config.motor_end_detect_run
                             :(uint16_t)config.motor_end_detect_cal) / 100)<<3;
             motor_timer = motor_max_time_for_impulse<<2; // *4 (for motor start-up)
+#if MOTOR_EYE_TIMESTAMP
+            MOTOR_set_deadline();
+            TIMSK1 = (1<<OCIE1A); // one interrupt per deadline instead of timer0 overflows
+#else
             TIFR0 = (1<<TOV0); // clean interrupt flag
             TCNT0 = 0;
             TIMSK0 = (1<<TOIE0); //enable interrupt from timer0 overflow
+#endif
             pine_last=PINE;
 
             PCMSK0 |= _BV(MOTOR_EYE_IN); // enable interrupt from eye
@@ -317,6 +538,9 @@ void MOTOR_timer_pulse(void) {
 void MOTOR_timer_stop(void) {
     motor_dir_t d = MOTOR_Dir;
     MOTOR_Control(stop);
+#if MOTOR_LOG
+    MOTOR_log_end((motor_timer>0)?MOTOR_LOG_REACHED:MOTOR_LOG_STALL);
+#endif
     if (motor_timer>0) { // normal stop on wanted position 
             if (MOTOR_calibration_step != 0) {
                 MOTOR_calibration_step = -1;     // calibration error
@@ -365,6 +589,9 @@ void MOTOR_timer_stop(void) {
         MOTOR_calibration_step = -1;     // calibration error
         CTL_error |=  CTL_ERR_MOTOR;
     } 
+#if MOTOR_RESUME
+    if (CTL_error & CTL_ERR_BATT_LOW) MOTOR_resume_save(); // battery can die before next run
+#endif
 }
 
 // interrupts: 
@@ -379,6 +606,9 @@ void MOTOR_timer_stop(void) {
  ******************************************************************************/
 ISR (PCINT0_vect){
     uint8_t pine=PINE;
+#if MOTOR_EYE_TIMESTAMP
+    uint16_t now=TCNT1; // edge timestamp
+#endif
     #if (defined COM_RS232) || (defined COM_RS485)
         if ((pine & (1<<PE0)) == 0) {
             RS_enable_rx(); // it is macro, not function
@@ -388,8 +618,13 @@ ISR (PCINT0_vect){
     // motor eye
     // count  HIGH impulses for HR20 and LOW Pulses for THERMOTRONIC
     if ((PCMSK0 & _BV(MOTOR_EYE_IN)) && (((pine ^ pine_last) & _BV(MOTOR_EYE_IN)) != 0)) {
+#if MOTOR_EYE_TIMESTAMP
+        uint16_t dur = now - last_eye_change;
+        last_eye_change = now;
+#else
         uint16_t dur = motor_diag_cnt - last_eye_change;
         last_eye_change = motor_diag_cnt;
+#endif
 #if MOTOR_EYE_POL == 0
         if ((pine & _BV(MOTOR_EYE_IN))!=0) {
 #else
@@ -402,11 +637,24 @@ ISR (PCINT0_vect){
                     #if DEBUG_MOTOR_COUNTER
                         MOTOR_counter++;
                     #endif
+#if MOTOR_EYE_TIMESTAMP
+                    motor_diag = now - motor_pulse_time;
+                    longest_low_eye=0;
+                    motor_pulse_time = now;
+#else
                     motor_diag = motor_diag_cnt;
                     longest_low_eye=0;
                     motor_diag_cnt=0;
                     last_eye_change=0;
+#endif
                     task|=TASK_MOTOR_PULSE;
+#if MOTOR_LOG
+                    motor_log_sum += motor_diag;
+                    if (++motor_log_pulses > MOTOR_IGNORE_IMPULSES) {
+                        motor_log_sum_run += motor_diag;
+                        if (motor_diag > motor_log_peak) motor_log_peak = motor_diag;
+                    }
+#endif
                     if (MOTOR_PosAct == MOTOR_PosStop) {
                         // motor fast STOP
                         MOTOR_PosOvershoot=0;
@@ -415,6 +663,9 @@ ISR (PCINT0_vect){
                     } else {
                         motor_timer = motor_max_time_for_impulse;
                     }
+#if MOTOR_EYE_TIMESTAMP
+                    MOTOR_set_deadline();
+#endif
                 } else {
                     #if (DEBUG_PRINT_MOTOR>1)
                         COM_putchar('~');
@@ -432,6 +683,44 @@ ISR (PCINT0_vect){
   // do NOT add anything after RFM part
 }
 
+#if MOTOR_EYE_TIMESTAMP
+/*! 
+ *******************************************************************************
+ * Timer1 compare interupt, deadline from MOTOR_set_deadline()
+ * \note Timer1 is only active if the motor is running, Timer0 runs only PWM
+ ******************************************************************************/
+ISR (TIMER1_COMPA_vect){
+    uint16_t t = OCR1A - motor_pulse_time;
+    if ((uint8_t)(t>>8) >= config.motor_close_eye_timeout) {
+        // stop pwm signal and Timer0
+#if MOTOR_PWM==0
+		TCCR0A = 0;//no pwm
+#else
+		TCCR0A = (1<<WGM00) | (1<<WGM01); // 0b 0000 0011
+#endif
+		PCMSK0 &= ~_BV(MOTOR_EYE_IN); // disable eye interrupt
+        TIMSK1 = 0; // disable timer 1 interrupt
+        TCCR1B = 0; // stop timer 1, power_down_ADC() switch it off
+
+#if MOTOR_LOG
+        if (MOTOR_run_test()) motor_log_timeout = true;
+#endif
+        // photo eye
+        MOTOR_eye_disable();
+        task&=~(TASK_MOTOR_PULSE); // just ensurance
+        MOTOR_H_BRIDGE_stop(); // ensurance that motor is stop 
+    } else {
+        motor_timer = 0;
+        if (MOTOR_run_test()) {
+            motor_diag = t;
+            // motor fast STOP
+            task|=(TASK_MOTOR_STOP);
+            MOTOR_H_BRIDGE_stop();
+        }
+        MOTOR_set_deadline(); // eye timeout
+    }
+}
+#else
 /*! 
  *******************************************************************************
  * Timer0 overflow interupt
@@ -450,6 +739,9 @@ ISR (TIMER0_OVF_vect){
 		PCMSK0 &= ~_BV(MOTOR_EYE_IN); // disable eye interrupt
         TIMSK0 = 0; // disable timmer 1 interrupt 
 
+#if MOTOR_LOG
+        if (MOTOR_run_test()) motor_log_timeout = true;
+#endif
         // photo eye
         MOTOR_eye_disable();
         task&=~(TASK_MOTOR_PULSE); // just ensurance
@@ -467,3 +759,4 @@ ISR (TIMER0_OVF_vect){
         }
     }
 }
+#endif
@@ -156,3 +156,31 @@ extern motor_dir_t MOTOR_Dir;          //!< actual direction
 extern volatile uint8_t MOTOR_PosOvershoot;
 extern uint32_t MOTOR_counter;         //!< count volume of motor pulses for dianostic
 
+#if MOTOR_LOG
+//! one motor run from start to stop, see MOTOR_log_get()
+typedef struct {
+    int16_t start;      //!< MOTOR_PosAct on start
+    int16_t stop;       //!< MOTOR_PosAct on stop
+    uint16_t pulses;    //!< counted eye impulses
+    uint16_t time;      //!< sum of impulse times / 256 (unit 16.4ms on 4MHz)
+    uint16_t diag_avg;  //!< average motor_diag, start-up impulses ignored
+    uint16_t diag_peak; //!< maximal motor_diag, start-up impulses ignored
+    uint8_t pwm;        //!< OCR0A on stop
+    uint8_t overshoot;  //!< MOTOR_PosOvershoot on stop
+    uint8_t reason;     //!< MOTOR_LOG_REACHED ... MOTOR_LOG_ABORT
+} motor_log_t;
+
+#define MOTOR_LOG_REACHED 0 //!< stopped on wanted position
+#define MOTOR_LOG_STALL   1 //!< no impulse in motor_max_time_for_impulse (end or stiff pin)
+#define MOTOR_LOG_TIMEOUT 2 //!< motor_close_eye_timeout expired during run
+#define MOTOR_LOG_ABORT   3 //!< new run started before stop
+
+uint8_t MOTOR_log_count(void);
+motor_log_t * MOTOR_log_get(uint8_t idx);  // 0 is newest
+#endif
+
+#if MOTOR_RESUME
+void MOTOR_resume_save(void);   // snapshot to EEPROM, only if calibrated and stopped
+void MOTOR_resume_load(void);   // skip calibration on boot if snapshot is valid
+#endif
+
@@ -0,0 +1,152 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 @ 4 MHz in Honnywell Rondostat HR20E
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       ota.c
+ * \brief      firmware update over wireless, staging for bootloader
+ * \date       $Date$
+ * $Rev$
+ */
+
+#include <stdint.h>
+#include <avr/io.h>
+#include <avr/pgmspace.h>
+#include <util/crc16.h>
+
+#include "config.h"
+#include "eeprom.h"
+#include "../common/xtea.h"
+#include "../common/wireless.h"
+#include "ota.h"
+
+#if (RFM==1) && OTA_UPDATE
+
+extern uint8_t __data_load_end[]; // end of application image (linker script)
+
+typedef void (*ota_spm_t)(uint8_t op, uint16_t addr, uint16_t data);
+#define ota_spm ((ota_spm_t)(OTA_BOOT_API / 2))
+
+static uint8_t ota_page;   // pages written to staging area
+static uint8_t ota_mask;   // chunks of next page loaded to SPM buffer
+bool ota_reboot = false;
+
+/*!
+ *******************************************************************************
+ *  \brief store one chunk of delta to staging area
+ *
+ *  \note chunks must come in page order, chunk inside page in any order
+ *  \note chunk of page which is written is accepted (master resend)
+ *******************************************************************************
+ */
+uint8_t ota_stage(uint8_t idx, uint8_t *data, uint8_t n) {
+    uint8_t page = idx / (SPM_PAGESIZE / OTA_CHUNK);
+    uint8_t bit = 1 << (idx % (SPM_PAGESIZE / OTA_CHUNK));
+    uint8_t i;
+    if ((uint16_t)__data_load_end > OTA_STAGE_START) return OTA_ERR_SPACE;
+    if ((n != OTA_CHUNK) || (idx >= OTA_STAGE_SIZE / OTA_CHUNK)) return OTA_ERR_RANGE;
+    if (page < ota_page) return OTA_OK;
+    if (page > ota_page) return OTA_ERR_ORDER;
+    if ((ota_mask & bit) == 0) {
+        uint16_t addr = OTA_STAGE_START + (uint16_t)idx * OTA_CHUNK;
+        for (i = 0; i < OTA_CHUNK; i += 2) {
+            ota_spm(0, addr + i, data[i] | ((uint16_t)data[i + 1] << 8));
+        }
+        ota_mask |= bit;
+    }
+    if (ota_mask == 0xff) {
+        ota_spm(1, OTA_STAGE_START + (uint16_t)page * SPM_PAGESIZE, 0);
+        ota_mask = 0;
+        ota_page++;
+    }
+    return OTA_OK;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief CMAC of staging area, same as cmac_calc but message is in Flash
+ *******************************************************************************
+ */
+static bool ota_cmac(uint16_t bytes, uint8_t *mac) {
+    uint8_t buf[8];
+    uint16_t i;
+    uint8_t j;
+    for (j = 0; j < 8; buf[j++] = 0) {;}
+    for (i = 0; i < bytes; ) { // i modification inside loop
+        uint16_t x = i;
+        uint8_t *Kx = NULL;
+        i += 8;
+        if (i >= bytes) Kx = ((i == bytes) ? K1 : K2);
+        for (j = 0; j < 8; j++, x++) {
+            uint8_t tmp;
+            if (x < bytes) tmp = pgm_read_byte(OTA_STAGE_START + x);
+            else tmp = ((x == bytes) ? 0x80 : 0);
+            if (Kx != NULL) tmp ^= Kx[j];
+            buf[j] ^= tmp;
+        }
+        xtea_enc(buf, buf, K_mac);
+    }
+    for (j = 0; j < 4; j++) {
+        if (mac[j] != buf[j]) return false;
+    }
+    return true;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief begin (len==0) or commit staged delta
+ *
+ *  - delta must be signed by CMAC with key of this device
+ *  - delta must be made for running firmware (CRC of base pages)
+ *  - bootloader apply it after reset
+ *
+ *  \note EEPROM write during staging clear SPM buffer, MAC check detect it
+ *******************************************************************************
+ */
+uint8_t ota_commit(uint16_t len, uint8_t *mac) {
+    uint16_t crc = 0;
+    uint16_t base;
+    uint16_t a;
+    if (len == 0) {
+        ota_page = 0;
+        ota_mask = 0;
+        return OTA_OK;
+    }
+    if (len > (uint16_t)ota_page * SPM_PAGESIZE) return OTA_ERR_RANGE;
+    if (!ota_cmac(len, mac)) return OTA_ERR_MAC;
+    base = (uint16_t)pgm_read_byte(OTA_STAGE_START + 2) * SPM_PAGESIZE;
+    if ((pgm_read_byte(OTA_STAGE_START) != 'D')
+        || (pgm_read_byte(OTA_STAGE_START + 1) != OTA_VERSION)
+        || (base > OTA_STAGE_START)) return OTA_ERR_FORMAT;
+    for (a = 0; a < base; a++) {
+        crc = _crc_xmodem_update(crc, pgm_read_byte(a));
+    }
+    if ((pgm_read_byte(OTA_STAGE_START + 3) != (crc >> 8))
+        || (pgm_read_byte(OTA_STAGE_START + 4) != (crc & 0xff))) return OTA_ERR_BASE;
+    EEPROM_write(OTA_FLAG_EEADDR, OTA_FLAG_COMMIT);
+    ota_reboot = true; // after reply is sent
+    return OTA_OK;
+}
+
+#endif
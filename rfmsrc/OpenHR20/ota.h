@@ -0,0 +1,56 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 @ 4 MHz in Honnywell Rondostat HR20E
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       ota.h
+ * \brief      firmware update over wireless, staging for bootloader
+ * \date       $Date$
+ * $Rev$
+ */
+
+#pragma once
+
+// staging area and bootloader address, same file is used by bootloader
+#include "../common/flash_layout.h"
+
+// SPM service of bootloader, it is in SPM_READY vector of boot section
+#define OTA_BOOT_API     (BOOT_START + SPM_READY_vect_num * 4)
+
+#define OTA_CHUNK        WL_BLOCK_MAX   // bytes in one 'O' command
+#define OTA_VERSION      1              // delta header: 'D' version base_pages crc_h crc_l
+#define OTA_HEADER       5
+
+#define OTA_OK           0
+#define OTA_ERR_RANGE    1
+#define OTA_ERR_ORDER    2
+#define OTA_ERR_SPACE    3   // application is overlapping staging area
+#define OTA_ERR_MAC      4
+#define OTA_ERR_FORMAT   5
+#define OTA_ERR_BASE     6   // delta is not made for running firmware
+
+extern bool ota_reboot;
+
+uint8_t ota_stage(uint8_t idx, uint8_t *data, uint8_t n);
+uint8_t ota_commit(uint16_t len, uint8_t *mac);
@@ -0,0 +1,146 @@
+#
+#  Open HR20
+#
+#  static stack depth check, called by "make stackcheck"
+#
+#  license:    This program is free software; you can redistribute it and/or
+#              modify it under the terms of the GNU Library General Public
+#              License as published by the Free Software Foundation; either
+#              version 2 of the License, or (at your option) any later version.
+#
+#              This program is distributed in the hope that it will be useful,
+#              but WITHOUT ANY WARRANTY; without even the implied warranty of
+#              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+#              GNU General Public License for more details.
+#
+#              You should have received a copy of the GNU General Public License
+#              along with this program. If not, see http:*www.gnu.org/licenses
+#
+# input:
+#   *.su files           frame size of every function (gcc -fstack-usage),
+#                        on AVR it includes saved registers and return address
+#   "avr-size -A" output static RAM (.data .bss .noinit)
+#   "avr-objdump -d"     call graph: call/rcall are calls, jmp/rjmp to start
+#                        of other function are tail calls
+#
+# variables (awk -v):
+#   ram       RAM size of MCU
+#   reserve   bytes which must stay free (default 0)
+#   libframe  frame of functions without .su (libgcc, avr-libc, xtea-asm.S),
+#             default 18 = return address + all call-saved registers r2-r17
+#   indirect  stack for icall targets, e.g. bootloader SPM service (default 32)
+#
+# worst case:
+#   main + all ISRs which enable interrupts (sei inside, each can be active
+#   only once, they disable own source) + deepest other ISR
+#
+# exit status 1 when worst case does not fit to RAM or call graph is unbounded
+
+BEGIN {
+	if (libframe == "") libframe = 18
+	if (indirect == "") indirect = 32
+	if (reserve == "") reserve = 0
+	err = 0
+}
+
+FILENAME ~ /\.su$/ {
+	name = $1
+	sub(/.*:/, "", name)
+	if (!(name in frame) || $2 > frame[name]) frame[name] = $2
+	if ($3 == "dynamic") unbounded[name] = 1
+	next
+}
+
+/^\.(data|bss|noinit)[ \t]/ {
+	sram += $2
+	next
+}
+
+/^[0-9a-f]+ <[^>]+>:$/ {
+	cur = $2
+	gsub(/[<>:]/, "", cur)
+	defined[cur] = 1
+	next
+}
+
+cur != "" && /\t(call|rcall|jmp|rjmp)\t/ {
+	if (!match($0, /<[^>]+>$/)) next
+	t = substr($0, RSTART + 1, RLENGTH - 2)
+	if (t ~ /\+/ || t == cur) next  # jump inside function
+	if (((cur, t) in linked)) next
+	linked[cur, t] = 1
+	edge[cur, ++edges[cur]] = t
+	next
+}
+
+cur != "" && /\t(icall|eicall)([ \t]|$)/ { icalls[cur] = 1; next }
+cur != "" && /\tsei([ \t]|$)/ { seis[cur] = 1; next }
+
+# worst case stack of function f including all callees, path[f] is deepest chain
+function depth(f,    i, c, d, best, bestpath) {
+	if (f in done) return dep[f]
+	if (f in active) {
+		print "recursion: " f
+		err = 1
+		return 0
+	}
+	active[f] = 1
+	best = 0
+	bestpath = ""
+	for (i = 1; i <= edges[f]; i++) {
+		c = edge[f, i]
+		d = depth(c)
+		if (nest[c]) nest[f] = 1
+		if (d > best) {
+			best = d
+			bestpath = " > " path[c]
+		}
+	}
+	if ((f in icalls) && indirect > best) {
+		best = indirect
+		bestpath = " > (icall)"
+	}
+	if (f in seis) nest[f] = 1
+	if (f in unbounded) {
+		print "dynamic stack: " f
+		err = 1
+	}
+	delete active[f]
+	done[f] = 1
+	dep[f] = ((f in frame) ? frame[f] : libframe) + best
+	path[f] = f bestpath
+	return dep[f]
+}
+
+END {
+	if (!("main" in defined)) {
+		print "stackcheck: no disassembly of main"
+		exit 1
+	}
+	total = depth("main")
+	printf "%-16s %5d  %s\n", "main", total, path["main"]
+	other = 0
+	for (f in defined) {
+		if (f !~ /^__vector_[0-9]+$/) continue
+		d = depth(f)
+		if (nest[f]) {
+			total += d
+			printf "%-16s %5d  %s  (enables interrupts)\n", f, d, path[f]
+		} else {
+			if (d > other) other = d
+			printf "%-16s %5d  %s\n", f, d, path[f]
+		}
+	}
+	total += other
+	budget = ram - sram - reserve
+	printf "\nworst case stack %d bytes, RAM %d - static %d - reserve %d = %d bytes\n", total, ram, sram, reserve, budget
+	if (total > budget) {
+		printf "stackcheck FAILED: %d bytes over budget\n", total - budget
+		exit 1
+	}
+	if (err) {
+		print "stackcheck FAILED: call graph can not be bounded"
+		exit 1
+	}
+	printf "stackcheck OK: %d bytes left\n", budget - total
+}
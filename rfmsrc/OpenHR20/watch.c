@@ -40,6 +40,7 @@
 #include "controller.h"
 #include "motor.h"
 #include "watch.h"
+#include "../common/wireless.h"
 #include "debug.h"
 
 #define B8 0x0000
@@ -50,12 +51,24 @@ int16_t MOTOR_PosMax;
 
 
 #if DEBUG_MOTOR_COUNTER
-    #define WATCH_LAYOUT 0x85
+    #define WATCH_LAYOUT_MC 0x80
 #else
-    #define WATCH_LAYOUT 0x05
+    #define WATCH_LAYOUT_MC 0x00
 #endif
+#if WL_RX_ADAPTIVE
+    #define WATCH_LAYOUT_RX 0x40
+#else
+    #define WATCH_LAYOUT_RX 0x00
+#endif
+#if WL_FEC
+    #define WATCH_LAYOUT_FEC 0x20
+#else
+    #define WATCH_LAYOUT_FEC 0x00
+#endif
+#define WATCH_LAYOUT (0x05|WATCH_LAYOUT_MC|WATCH_LAYOUT_RX|WATCH_LAYOUT_FEC)
 
 
+#if WATCH_N
 static const uint16_t watch_map[WATCH_N] PROGMEM = {
     /* 00 */ ((uint16_t) &sumError) + B16,
     /* 01 */ ((uint16_t) &sumError)+ 2 + B16,
@@ -70,9 +83,18 @@ static const uint16_t watch_map[WATCH_N] PROGMEM = {
 	/* 09 */ ((uint16_t) &MOTOR_counter) + B16,
 	/* 0a */ ((uint16_t) &MOTOR_counter)+ 2 + B16,
 #endif
+#if WL_RX_ADAPTIVE
+	/* 09/0b */ ((uint16_t) &wl_rx_tmo) + B16, // LO sync, HI reply window
+#endif
+#if WL_FEC
+	/* +0 */ ((uint16_t) &wl_fec_fixed) + B16,
+	/* +1 */ ((uint16_t) &wl_fec_failed) + B16,
+#endif
 };
+#endif
 
 uint16_t watch(uint8_t addr) {
+#if WATCH_N
 	uint16_t p;
 
 	if (addr >= WATCH_N) return WATCH_LAYOUT;
@@ -83,5 +105,8 @@ uint16_t watch(uint8_t addr) {
 	} else { // 8 bit value
 		return (uint16_t)(*((uint8_t *)(p)));
 	}
+#else
+	return WATCH_LAYOUT;
+#endif
 }
 
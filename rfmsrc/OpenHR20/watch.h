@@ -32,8 +32,27 @@
  */
 
 #pragma once
+#include "debug.h"
 
 uint16_t watch(uint8_t addr);
 
-#define WATCH_N (11)
+#if WL_RX_ADAPTIVE
+    #define WATCH_N_RX (1)
+#else
+    #define WATCH_N_RX (0)
+#endif
+#if WL_FEC
+    #define WATCH_N_FEC (2)
+#else
+    #define WATCH_N_FEC (0)
+#endif
+#define WATCH_N_RFM (WATCH_N_RX+WATCH_N_FEC)
+
+#if DEBUG_WATCH == 0
+    #define WATCH_N (0)
+#elif DEBUG_MOTOR_COUNTER
+    #define WATCH_N (11+WATCH_N_RFM)
+#else
+    #define WATCH_N (9+WATCH_N_RFM)
+#endif
 
@@ -0,0 +1,60 @@
+/*
+ *  Open HR20
+ *
+ *  target:     ATmega169 in Honnywell Rondostat HR20E / ATmega8
+ *
+ *  compiler:   WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       flash_layout.h
+ * \brief      Flash layout of slave, shared by firmware, bootloader and host tools
+ * \date       $Date$
+ * $Rev$
+ */
+
+#ifndef FLASH_LAYOUT_H
+#define FLASH_LAYOUT_H
+
+/*
+ * bootloader (trunk/source/bootloader) is in 2KB boot section,
+ * fuses BOOTSZ1=0 BOOTSZ0=0 (1024 words) as FUSES in OpenHR20/main.c,
+ * bootloader Makefile takes .text address and size limit from here
+ */
+#define BOOT_START       0x3800
+#define BOOT_END         0x4000   // FLASHEND+1 of ATmega169
+
+/*
+ * OTA staging area is last Flash pages below bootloader, application
+ * (OpenHR20/ota.c) writes delta there, bootloader applies it after reset
+ *
+ * backup page is written by bootloader only: new content of page which is
+ * rewritten, OTA_PAGE_EEADDR is its page number (OTA_PAGE_EEADDR-1 inverted)
+ * while target page is erased/written, it is restored from backup after reset
+ */
+#define OTA_BACKUP_SIZE  0x80     // SPM_PAGESIZE of ATmega169
+#define OTA_BACKUP_START (BOOT_START - OTA_BACKUP_SIZE)
+#define OTA_STAGE_SIZE   0x200
+#define OTA_STAGE_START  (OTA_BACKUP_START - OTA_STAGE_SIZE)
+#define OTA_FLAG_EEADDR  E2END
+#define OTA_FLAG_COMMIT  0xA5
+#define OTA_PAGE_EEADDR  (E2END - 1)
+
+#endif
@@ -179,6 +179,7 @@ void RS_Init(void)
  ******************************************************************************/
 void RS_startSend(void)
 {
+	uint8_t sreg=SREG; // can be called from ISR
 	cli();
 	#if defined COM_RS485
 		// TODO: change rs485 to transmit
@@ -190,7 +191,7 @@ void RS_startSend(void)
 			UCSR0B |= _BV(UDRIE0) | _BV(TXEN0);
 			// UDR0 = COM_tx_char_isr(); // done in interrupt
 		}
-	sei();
+	SREG=sreg;
 }
 
 #endif /* COM_RS232 */
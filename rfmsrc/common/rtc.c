@@ -67,6 +67,11 @@ rtc_t RTC = {
 };
 
 uint8_t RTC_DS;     //!< Daylightsaving Flag
+#if (RTC_DRIFT) && !defined(MASTER_CONFIG_H)
+    int16_t RTC_drift=0;
+    static int16_t RTC_drift_acc=0;    //!< correction not applied yet
+    static uint16_t RTC_drift_age=0;   //!< seconds from last sync
+#endif
 #ifdef RTC_TICKS
     uint32_t RTC_Ticks=0; //!< Ticks since last Reset
 #endif
@@ -196,6 +201,9 @@ void RTC_SetMinute(int8_t minute)
 void RTC_SetSecond(int8_t second)
 {
     RTC.ss = (uint8_t)(second+60)%60;
+    #if (RTC_TICKLESS) && !defined(MASTER_CONFIG_H)
+        RTC_pending = 0; // slept seconds are part of new time
+    #endif
 }
 
 
@@ -388,6 +396,10 @@ void RTC_AddOneSecond(void)
 #endif
 #if (RFM==1)
     RTC.pkt_cnt=0;
+#endif
+#if (RTC_DRIFT) && !defined(MASTER_CONFIG_H)
+    RTC_drift_acc+=RTC_drift;
+    if (RTC_drift_age<0xffff) RTC_drift_age++;
 #endif
 	if (++RTC.ss >= 60) {
 		RTC.ss = 0;
@@ -607,6 +619,10 @@ void RTC_timer_set(uint8_t timer_id, uint8_t time) {
 }
 
 #if !defined(MASTER_CONFIG_H)
+    #if (RTC_TICKLESS)
+        volatile uint8_t RTC_pending = 0;
+        volatile uint8_t RTC_sleep = 1;
+    #endif
     /*!
      *******************************************************************************
      *
@@ -614,11 +630,15 @@ void RTC_timer_set(uint8_t timer_id, uint8_t time) {
      *
      *  \note
      *  - add one second to internal clock
+     *  - RTC_TICKLESS: count seconds, main loop is woken up after RTC_sleep seconds
      *
      ******************************************************************************/
-    #if !TASK_IS_SFR || DEBUG_PRINT_RTC_TICKS
+    #if !TASK_IS_SFR || DEBUG_PRINT_RTC_TICKS || RTC_TICKLESS
     // not optimized
     ISR(TIMER2_OVF_vect) {
+        #if (RTC_TICKLESS)
+            if (++RTC_pending < RTC_sleep) return;
+        #endif
         task |= TASK_RTC;   // increment second and check Dow_Timer
         RTC_timer_done |= _BV(RTC_TIMER_OVF) | _BV(RTC_TIMER_RTC);
         #if (DEBUG_PRINT_RTC_TICKS)
@@ -737,62 +757,183 @@ void RTC_timer_set(uint8_t timer_id, uint8_t time) {
 #endif 
 
 
+#if (RTC_DRIFT) && !defined(MASTER_CONFIG_H)
+/*!
+ *******************************************************************************
+ *  update drift estimation from time sync
+ *
+ *  \param err RTC_s256 error found by sync, positive = RTC was ahead
+ *  \note residual error after correction is integrated with gain 1/4,
+ *        sync after long gap or with big error only restart measure
+ ******************************************************************************/
+void RTC_DriftSync(int8_t err)
+{
+    if ((RTC_drift_age>=20) && (RTC_drift_age<=1200) && (err>-16) && (err<16)) {
+        int16_t d = RTC_drift + (int16_t)(((int32_t)err*(RTC_DRIFT_ONE/4))/(int16_t)RTC_drift_age);
+        if (d>RTC_DRIFT_MAX) d=RTC_DRIFT_MAX;
+        if (d<-RTC_DRIFT_MAX) d=-RTC_DRIFT_MAX;
+        RTC_drift = d;
+    }
+    RTC_drift_age=0;
+    RTC_drift_acc=0; // phase is set by sync
+}
+
+/*!
+ *******************************************************************************
+ *  move timer2 by one 1/256s step when accumulated drift is big enough
+ *
+ *  \note call it after second change; it wait for begin of next timer2
+ *        step (max 4ms), write on overflow or with active RTC_timer is not
+ *        safe and correction is postponed
+ ******************************************************************************/
+void RTC_DriftApply(void)
+{
+    int8_t step;
+    uint8_t t;
+    if (RTC_drift_acc>=RTC_DRIFT_ONE) {
+        step=-1;
+    } else if (RTC_drift_acc<=-RTC_DRIFT_ONE) {
+        step=1;
+    } else return;
+    if (RTC_timer_todo!=0) return;
+    while (ASSR & (_BV(TCN2UB)|_BV(TCR2UB))) {;} // ATmega169 datasheet chapter 17.8.1
+    t=TCNT2;
+    while (TCNT2==t) {;}
+    t++;
+    if ((t==0) || (t>0xf0)) return; // overflow is near
+    TCNT2=t+step;
+    while (ASSR & _BV(TCN2UB)) {;}
+    RTC_drift_acc+=step*RTC_DRIFT_ONE;
+}
+#endif
+
 #if HAS_CALIBRATE_RCO && !defined(MASTER_CONFIG_H)
+
+#define RCO_TICKS 2     //!< measure time in RTC_s256 ticks
+#define RCO_TARGET ((uint16_t)(F_CPU/256*RCO_TICKS)) //!< CPU clocks in RCO_TICKS
+#define RCO_TOLERANCE (RCO_TARGET/100) //!< 1%, UART need 2%
+#define RCO_TEMP_MIN 0      //!< first temperature bucket [1/100 C]
+#define RCO_TEMP_STEP 400   //!< bucket size [1/100 C]
+#define RCO_TEMP_BUCKETS 10
+#define RCO_CHECK 60        //!< learned value is checked every 60 calls
+
+static uint8_t rco_table[RCO_TEMP_BUCKETS]; //!< learned OSCCAL, 0 is not loaded from EE_RCO
+static uint8_t rco_age;                     //!< calls from last check
+
+/*!
+ *******************************************************************************
+ *  Measure internal RC oscillator against 32,768 kHz crystal
+ *
+ *  \returns CPU clocks in RCO_TICKS of RTC_s256
+ *
+ *  \note Timer2 is only read, RTC is running
+ *  \note global interrupt is disabled only for one measurement (about 12ms)
+ ******************************************************************************/
+static uint16_t rco_measure(void)
+{
+    uint8_t sreg = SREG;
+    uint16_t m = 0xffff;
+    uint8_t t;
+    cli();
+    t = TCNT2;
+    while (TCNT2 == t) {;}          // wait for edge of crystal timer
+    TCNT1 = 0;
+    TIFR1 = (1<<TOV1);
+    TCCR1B = (1<<CS10);             // start timer1 with no prescaling
+    t += 1 + RCO_TICKS;
+    while (TCNT2 != t) {;}
+    TCCR1B = 0;                     // stop timer1
+    if ((TIFR1 & (1<<TOV1)) == 0) m = TCNT1;
+    SREG = sreg;
+    return m;
+}
+
+static uint16_t rco_diff(uint16_t m)
+{
+    return (m > RCO_TARGET) ? (m - RCO_TARGET) : (RCO_TARGET - m);
+}
+
+/*!
+ *******************************************************************************
+ *  Change OSCCAL in small steps, big change can make CPU unstable
+ ******************************************************************************/
+static void rco_set(uint8_t cal)
+{
+    while (OSCCAL != cal) {
+        if (OSCCAL < cal) OSCCAL++; else OSCCAL--;
+    }
+}
+
+/*!
+ *******************************************************************************
+ *  Binary search of OSCCAL inside actual range (OSCCAL bit 7)
+ ******************************************************************************/
+static uint8_t rco_search(void)
+{
+    uint8_t cal = OSCCAL & 0x80;
+    uint8_t bit;
+    uint16_t d;
+
+    for (bit = 0x40; bit != 0; bit >>= 1) {
+        rco_set(cal | bit);
+        if (rco_measure() <= RCO_TARGET) cal |= bit;  // not too fast, keep bit
+    }
+    // cal is last value not faster than target, cal+1 can be closer
+    rco_set(cal);
+    d = rco_diff(rco_measure());
+    if ((cal & 0x7f) != 0x7f) {
+        rco_set(cal + 1);
+        if (rco_diff(rco_measure()) >= d) rco_set(cal);
+    }
+    return OSCCAL;
+}
+
 /*!
  *******************************************************************************
  *
  *  Calibrate the internal OSCCAL byte,
  *  using the external 32,768 kHz crystal as reference
  *
- *  \note
- *     global interrupt has to be disabled before if not if will be
- *     disabled by this function.
+ *  - OSCCAL is learned for temperature buckets and kept in EEPROM (EE_RCO),
+ *    value from EEPROM is checked on first use after reset
+ *  - known bucket: OSCCAL is set without measurement,
+ *    one measurement every RCO_CHECK calls
+ *  - unknown bucket or check fail: binary search, 9 measurements,
+ *    interrupts are enabled between them
+ *
+ *  \param temp temperature [1/100 C]
+ *
+ *  \note call it when UART, RFM and motor does not need exact clock
  *
  ******************************************************************************/
-void calibrate_rco(void)
+void calibrate_rco(int16_t temp)
 {
-    unsigned char calibrate = FALSE;
-    int temp;
-
-    cli();                               // disable global interrupt
-    CLKPR = (1<<CLKPCE);                 // set Clock Prescaler Change Enable
-    CLKPR = (1<<CLKPS1) | (1<<CLKPS0);   // set prescaler = 8  =>  1Mhz
-    TIMSK2 = 0;                          // disable OCIE2A and TOIE2
-    ASSR = (1<<AS2);                     // timer2 asynchronous 32,768kHz)
-    OCR2A = 200;                         // set timer2 compare value
-    TIMSK0 = 0;                          // delete any interrupt sources
-    TCCR1B = (1<<CS10);                  // start timer1 with no prescaling
-    TCCR2A = (1<<CS20);                  // start timer2 with no prescaling
-
-    while((ASSR & 0x01) | (ASSR & 0x04));// wait for clear TCN2UB and TCR2UB
-    // delay(1000);                      // wait for external crystal stabilise
-
-    while(!calibrate)
-    {
-        TIFR1 = 0xFF;   // delete TIFR1 flags
-        TIFR2 = 0xFF;   // delete TIFR2 flags
-        TCNT1H = 0;     // clear timer1 counter
-        TCNT1L = 0;
-        TCNT2 = 0;      // clear timer2 counter
-
-        while ( !(TIFR2 & (1<<OCF2A)) );   // wait for timer2 compareflag
-
-        TCCR1B = 0;     // stop timer1
-
-        if (TIFR1 & (1<<TOV1))  {
-            temp = 0xFFFF;                // timer1 overflow, set temp to 0xFFFF
-        } else {
-            temp = (TCNT1H << 8) | TCNT1L;  // read out the timer1 counter value
-        }
+    uint8_t prr = PRR;
+    uint8_t b;
+    uint8_t cal;
+
+    if (temp < RCO_TEMP_MIN) temp = RCO_TEMP_MIN;
+    b = (uint16_t)(temp - RCO_TEMP_MIN) / RCO_TEMP_STEP;
+    if (b >= RCO_TEMP_BUCKETS) b = RCO_TEMP_BUCKETS - 1;
+    cal = rco_table[b];
+    if (cal == 0) {
+        cal = EEPROM_read(EE_RCO + b);
+        if (cal == 0xff) cal = 0;
+        rco_age = RCO_CHECK;             // check it now
+    }
 
-        if (temp > 6250) {
-            OSCCAL--;   // internRC oscillator to fast, decrease the OSCCAL
-        } else if (temp < 6120) {
-            OSCCAL++;   // internRC oscillator to slow, increase the OSCCAL
-        } else {
-            calibrate = TRUE;   // the interRC is correct
+    if ((cal != 0) && (++rco_age < RCO_CHECK)) {
+        rco_set(cal);
+    } else {
+        rco_age = 0;
+        PRR &= ~(1<<PRTIM1);             // timer1 power on
+        if (cal != 0) rco_set(cal);
+        if ((cal == 0) || (rco_diff(rco_measure()) > RCO_TOLERANCE)) {
+            cal = rco_search();
         }
-        TCCR1B = (1<<CS10); // start timer1
+        rco_table[b] = cal;
+        if (EEPROM_read(EE_RCO + b) != cal) EEPROM_write(EE_RCO + b, cal);
+        PRR = prr;
     }
 }
 #endif
@@ -44,7 +44,7 @@
 #define RTC_TIMERS_PER_DOW    8
 
 //! Do we support calibrate_rco
-#define	HAS_CALIBRATE_RCO     0
+#define	HAS_CALIBRATE_RCO     1
 
 //! RTC high precision timers
 #define RTC_TIMER_OVF 0 //
@@ -146,11 +146,23 @@ void RTC_AddOneSecond(void);
 
 extern uint8_t RTC_timer_done;
 extern uint8_t RTC_timer_todo;
+#if (RTC_TICKLESS) && !defined(MASTER_CONFIG_H)
+    extern volatile uint8_t RTC_pending; //!< seconds counted by timer2, not added to RTC yet
+    extern volatile uint8_t RTC_sleep;   //!< wake up main loop after this count of seconds
+#endif
 void RTC_timer_set(uint8_t timer_id, uint8_t time);
 #define RTC_timer_destroy(timer_id) (RTC_timer_todo &= ~_BV(timer_id), RTC_timer_done &= ~_BV(timer_id))
 
 #if	HAS_CALIBRATE_RCO
-void calibrate_rco(void);
+void calibrate_rco(int16_t temp);
+#endif
+
+#if (RTC_DRIFT) && !defined(MASTER_CONFIG_H)
+#define RTC_DRIFT_ONE 4096  //!< RTC_drift unit is 1/RTC_DRIFT_ONE of 1/256s per second (~1ppm)
+#define RTC_DRIFT_MAX 256   //!< ~240ppm, worse crystal is broken
+extern int16_t RTC_drift;   //!< estimated drift, positive = RTC is fast
+void RTC_DriftSync(int8_t err);
+void RTC_DriftApply(void);
 #endif
 
 #endif /* RTC_H */
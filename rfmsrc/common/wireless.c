@@ -43,9 +43,13 @@
 #include "debug.h"
 #if defined(MASTER_CONFIG_H)
     #include "queue.h"
+    #include "linkq.h"
 #else
+    #include <avr/wdt.h>
     #include "controller.h"
     #include "task.h"
+    #include "ota.h"
+    #include "motor.h"
 #endif
 
 #if RFM
@@ -65,6 +69,25 @@ static uint8_t wireless_framebuf[WIRELESS_BUF_MAX];
       
 uint8_t wireless_buf_ptr=0;
 
+#if (WL_FEC)
+uint16_t wl_fec_fixed=0;  //!< frames corrected by FEC
+uint16_t wl_fec_failed=0; //!< FEC frames with wrong MAC after correction
+#if defined(MASTER_CONFIG_H)
+static bool wl_fec_tx=false;     //!< reply with FEC, same as request
+static uint32_t wl_fec_slaves=0; //!< slaves with FEC in last valid frame
+static uint8_t wl_fec_undo[4];   //!< position and xor of bytes changed by wl_fec_decode
+#define WL_FEC_TX (wl_fec_tx)
+#else
+#define WL_FEC_TX (config.RFM_fec)
+#endif
+#define WL_FEC_RESERVE (WL_FEC_TX?WL_FEC_BYTES:0)
+
+#define WL_FEC_NONE 0
+#define WL_FEC_CLEAN 1
+#define WL_FEC_FIXED 2
+#define WL_FEC_FAIL 3
+#endif
+
 static const uint8_t Km_upper[8] PROGMEM = {
     0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef
 };
@@ -156,6 +179,174 @@ static void encrypt_decrypt (uint8_t* p, uint8_t len) {
     }
 }
 
+#if (WL_FEC)
+/*!
+ *******************************************************************************
+ *  multiply by alpha in GF(2^8), polynomial 0x11d
+ ******************************************************************************/
+static uint8_t wl_fec_xtime(uint8_t x) {
+    return (x&0x80)?((x<<1)^0x1d):(x<<1);
+}
+
+/*!
+ *******************************************************************************
+ *  parity of 2 interleaved codewords
+ *
+ *  \note s[0..1] = P xor of even/odd bytes, s[2..3] = Q sum of d[m]*alpha^m,
+ *        m is index of byte inside codeword
+ ******************************************************************************/
+static void wl_fec_parity(uint8_t *p, uint8_t n, uint8_t *s) {
+    s[0]=s[1]=s[2]=s[3]=0;
+    while (n>0) {
+        n--;
+        s[n&1]^=p[n];
+        s[2+(n&1)]=wl_fec_xtime(s[2+(n&1)])^p[n];
+    }
+}
+
+/*!
+ *******************************************************************************
+ *  check parity and correct one byte in each codeword
+ *
+ *  \note without fix only clean frame is accepted
+ *  \returns WL_FEC_CLEAN, WL_FEC_FIXED or WL_FEC_FAIL
+ ******************************************************************************/
+static uint8_t wl_fec_decode(uint8_t *p, uint8_t n, bool fix) {
+    uint8_t s[4];
+    uint8_t k,i,t;
+    uint8_t ret=WL_FEC_CLEAN;
+    #if defined(MASTER_CONFIG_H)
+    wl_fec_undo[1]=wl_fec_undo[3]=0;
+    #endif
+    wl_fec_parity(p,n,s);
+    for (k=0;k<4;k++) s[k]^=p[n+k];
+    if (!fix) return (s[0]|s[1]|s[2]|s[3])?WL_FEC_FAIL:WL_FEC_CLEAN;
+    for (k=0;k<2;k++) {
+        if ((s[k]==0) || (s[2+k]==0)) continue; // codeword is ok or error is in parity byte
+        // error e=s[k] at m: s[2+k] = e*alpha^m
+        t=s[k];
+        for (i=k;i<n;i+=2) {
+            if (t==s[2+k]) break;
+            t=wl_fec_xtime(t);
+        }
+        if (i>=n) return WL_FEC_FAIL;
+        p[i]^=s[k];
+        #if defined(MASTER_CONFIG_H)
+        wl_fec_undo[2*k]=i;
+        wl_fec_undo[2*k+1]=s[k];
+        #endif
+        ret=WL_FEC_FIXED;
+    }
+    return ret;
+}
+
+/*!
+ *******************************************************************************
+ *  remove FEC from received data frame
+ *
+ *  \note master use FEC for slave which sent clean FEC frame last time
+ *  \returns WL_FEC_NONE for frame without FEC
+ ******************************************************************************/
+static uint8_t wl_fec_rx(void) {
+    uint8_t n=rfm_framepos-WL_FEC_BYTES;
+    uint8_t r;
+    if (rfm_framepos<WL_FEC_BYTES+6) return WL_FEC_NONE;
+    #if defined(MASTER_CONFIG_H)
+        r=wl_fec_decode(rfm_framebuf,n,false);
+        if (r!=WL_FEC_CLEAN) {
+            if ((rfm_framebuf[1]>=32) || (((wl_fec_slaves>>rfm_framebuf[1])&1)==0)) return WL_FEC_NONE;
+            r=wl_fec_decode(rfm_framebuf,n,true);
+        }
+    #else
+        if (!config.RFM_fec) return WL_FEC_NONE;
+        r=wl_fec_decode(rfm_framebuf,n,true);
+    #endif
+    rfm_framepos=n;
+    rfm_framebuf[0]=n;
+    return r;
+}
+
+#if defined(MASTER_CONFIG_H)
+/*!
+ *******************************************************************************
+ *  revert wl_fec_rx, frame is received again without FEC
+ *
+ *  \note slave can switch RFM_fec off, its bit in wl_fec_slaves is still set
+ ******************************************************************************/
+static void wl_fec_revert(void) {
+    rfm_framebuf[wl_fec_undo[0]]^=wl_fec_undo[1];
+    rfm_framebuf[wl_fec_undo[2]]^=wl_fec_undo[3];
+    rfm_framepos+=WL_FEC_BYTES;
+    rfm_framebuf[0]=rfm_framepos;
+}
+#endif
+
+/*!
+ *******************************************************************************
+ *  FEC statistic, master remember FEC usage per slave
+ ******************************************************************************/
+static void wl_fec_count(uint8_t r, bool mac_ok) {
+    if (r==WL_FEC_NONE) {
+        #if defined(MASTER_CONFIG_H)
+        if (mac_ok) {
+            if (rfm_framebuf[1]<32) wl_fec_slaves&=~((uint32_t)1<<rfm_framebuf[1]);
+            wl_fec_tx=false;
+        }
+        #endif
+        return;
+    }
+    if (mac_ok) {
+        if ((r==WL_FEC_FIXED) && (wl_fec_fixed!=0xffff)) wl_fec_fixed++;
+        #if defined(MASTER_CONFIG_H)
+        if (rfm_framebuf[1]<32) wl_fec_slaves|=(uint32_t)1<<rfm_framebuf[1];
+        wl_fec_tx=true;
+        #endif
+    } else {
+        if (wl_fec_failed!=0xffff) wl_fec_failed++;
+    }
+}
+#endif
+
+#if (WL_RX_ADAPTIVE) && !defined(MASTER_CONFIG_H)
+uint8_t wl_rx_tmo[2]={WLTIME_SYNC_TIMEOUT,WLTIME_TIMEOUT};
+static uint8_t wl_rx_peak[2]={WLTIME_SYNC_TIMEOUT,WLTIME_TIMEOUT}; //!< latest arrival, decay 1 step per packet
+static uint8_t wl_rx_start; //!< RTC_s256 when RX window was opened
+static uint8_t wl_rx_window=WL_RX_NONE;
+
+#define wl_rx_default(w) (((w)==WL_RX_SYNC)?WLTIME_SYNC_TIMEOUT:WLTIME_TIMEOUT)
+
+/*!
+ *******************************************************************************
+ *  open RX window with learned length
+ ******************************************************************************/
+static void wl_rx_open(uint8_t w) {
+    wl_rx_window=w;
+    wl_rx_start=RTC_s256;
+    RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(wl_rx_start + wl_rx_tmo[w]));
+}
+
+/*!
+ *******************************************************************************
+ *  valid packet is received in RX window, learn its arrival
+ *  \note window is peak arrival + WLTIME_RX_MARGIN, up to original timeout
+ ******************************************************************************/
+static void wl_rx_learn(void) {
+    uint8_t w=wl_rx_window;
+    uint8_t t;
+    if (w==WL_RX_NONE) return;
+    wl_rx_window=WL_RX_NONE;
+    t=RTC_s256-wl_rx_start;
+    if (t>=wl_rx_peak[w]) {
+        wl_rx_peak[w]=t;
+    } else {
+        wl_rx_peak[w]--;
+    }
+    t=wl_rx_default(w);
+    if (wl_rx_peak[w]+WLTIME_RX_MARGIN<t) t=wl_rx_peak[w]+WLTIME_RX_MARGIN;
+    wl_rx_tmo[w]=t;
+}
+#endif
+
 /*!
  *******************************************************************************
  *  wireless send Done
@@ -165,6 +356,9 @@ void wirelessSendDone(void) {
     rfm_mode    = rfmmode_stop;
     #if defined(MASTER_CONFIG_H)
         wireless_buf_ptr=0;
+        #if (LINKQ)
+        LQ_tx_done();
+        #endif
     #endif
     rfm_framepos=0;
 
@@ -175,9 +369,23 @@ void wirelessSendDone(void) {
     RFM_INT_EN(); // enable RFM interrupt
 
     #if !defined(MASTER_CONFIG_H)
+        #if OTA_UPDATE
+        if (ota_reboot) { // bootloader apply committed firmware
+            #if MOTOR_RESUME
+            MOTOR_resume_save(); // new firmware reject it if RESUME_MAGIC is changed
+            #endif
+            cli();
+            wdt_enable(WDTO_15MS);
+            while(1);
+        }
+        #endif
         wirelessTimerCase = WL_TIMER_RX_TMO;
         while (ASSR & (_BV(TCR2UB))) {;}
+        #if (WL_RX_ADAPTIVE)
+        wl_rx_open(WL_RX_REPLY);
+        #else
         RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s256 + WLTIME_TIMEOUT));    
+        #endif
         COM_print_time('r');
     #endif    
 }
@@ -206,9 +414,28 @@ void wirelessTimer(void) {
       	rfm_mode = rfmmode_rx;
         wirelessTimerCase = WL_TIMER_RX_TMO;
         while (ASSR & (_BV(TCR2UB))) {;}
+        #if (WL_RX_ADAPTIVE)
+        wl_rx_open(WL_RX_SYNC);
+        #else
         RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s256 + WLTIME_SYNC_TIMEOUT));    
+        #endif
         break;
     case WL_TIMER_RX_TMO:
+        #if (WL_RX_ADAPTIVE)
+        if (wl_rx_window!=WL_RX_NONE) {
+            uint8_t w=wl_rx_window;
+            bool late = (wl_rx_tmo[w]<wl_rx_default(w)) && (rfm_mode==rfmmode_rx) && (rfm_framepos>0);
+            // nothing received in learned window, back to worst case
+            wl_rx_window=WL_RX_NONE;
+            wl_rx_peak[w]=wl_rx_tmo[w]=wl_rx_default(w);
+            if (late) { // packet is just coming, give it rest of original window
+                wl_rx_window=w;
+                while (ASSR & (_BV(TCR2UB))) {;}
+                RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(wl_rx_start + wl_rx_tmo[w]));
+                return;
+            }
+        }
+        #endif
         if (rfm_mode!= rfmmode_tx) {
             RFM_INT_DIS();
             rfm_mode    = rfmmode_stop;
@@ -265,6 +492,14 @@ static void wirelessSendPacket(bool cpy) {
     encrypt_decrypt (rfm_framebuf+6, rfm_framesize - 4-2);
     cmac_calc(rfm_framebuf+5,rfm_framesize-5,(uint8_t*)&RTC,false);
     RTC.pkt_cnt++;
+    #if (WL_FEC)
+    if (WL_FEC_TX) {
+        // length is not covered by MAC, but it is part of FEC codeword
+        rfm_framebuf[4]+=WL_FEC_BYTES;
+        wl_fec_parity(rfm_framebuf+4,rfm_framesize,rfm_framebuf+4+rfm_framesize);
+        rfm_framesize+=WL_FEC_BYTES;
+    }
+    #endif
     rfm_framesize+=4+2; //4 MAC + 2 dummy
 	// rfm_framebuf[rfm_framesize++] = 0xaa; // dummy byte is not significant
 	// rfm_framebuf[rfm_framesize++] = 0xaa; // dummy byte is not significant
@@ -287,6 +522,71 @@ uint8_t wl_force_addr1;
 uint8_t wl_force_addr2;
 uint32_t wl_force_flags;
 
+#if (WL_GROUP_CMD)
+#if defined(MASTER_CONFIG_H)
+static uint8_t wl_group_buf[WL_GROUP_MAX]; //!< seq group cmd param[]
+static uint8_t wl_group_repeat;
+
+/*!
+ *******************************************************************************
+ *  set group command, it is sent in next WL_GROUP_REPEAT sync packets
+ *
+ *  \returns false if previous group command is not finished
+ ******************************************************************************/
+bool wl_group_set(uint8_t group, uint8_t *cmd, uint8_t len) {
+    if ((wl_group_repeat>0) || (len+2>WL_GROUP_MAX)) return false;
+    if (++wl_group_buf[0]==0) wl_group_buf[0]=1; // slave start with 0
+    wl_group_buf[1]=group;
+    memcpy(wl_group_buf+2,cmd,len);
+    memset(wl_group_buf+2+len,0,WL_GROUP_MAX-2-len); // sync length is fixed
+    wl_group_repeat=WL_GROUP_REPEAT;
+    return true;
+}
+
+/*!
+ *******************************************************************************
+ *  append group command to sync packet behind time
+ *
+ *  \note use only for sync without force addresses, see wireless.h
+ *  \returns false if there is no group command to send
+ ******************************************************************************/
+bool wl_group_put(void) {
+    uint8_t i;
+    if (wl_group_repeat==0) return false;
+    wl_group_repeat--;
+    for (i=0;i<WL_GROUP_MAX;i++) {
+        wireless_putchar(wl_group_buf[i]);
+    }
+    return true;
+}
+#else
+static uint8_t wl_group_seq=0; //!< last applied group command
+
+/*!
+ *******************************************************************************
+ *  sync packet time is our time or one minute later
+ *
+ *  \note sync is not protected against replay, group command is accepted
+ *         only if we are in sync and this is true
+ ******************************************************************************/
+static bool wl_group_time_ok(void) {
+    uint8_t m=rfm_framebuf[4]>>1;
+    uint8_t h=RTC_GetHour();
+    if ((CTL_error & CTL_ERR_RFM_SYNC)!=0) return false;
+    if ((uint8_t)(m+60-RTC_GetMinute())%60 > 1) return false;
+    if (m>=RTC_GetMinute()) {
+        return (rfm_framebuf[3]==(uint8_t)((RTC_GetDay()<<5)+h));
+    }
+    // minute 59 -> 0, packet is in next hour
+    if (++h<24) {
+        return (rfm_framebuf[3]==(uint8_t)((RTC_GetDay()<<5)+h));
+    }
+    // next day, it is not always day+1 (end of month)
+    return ((rfm_framebuf[3]&0x1f)==0) && ((rfm_framebuf[3]>>5)!=(RTC_GetDay()&7));
+}
+#endif
+#endif
+
 #if defined(MASTER_CONFIG_H)
 void wirelessSendSync(void) {
     LED_sync_on();
@@ -312,11 +612,13 @@ void wirelessSendSync(void) {
     RFM_INT_EN(); // enable RFM interrupt
 }
 
-uint8_t wl_packet_bank=0;
 #else
 	int8_t time_sync_tmo=0;
 	#if (WL_SKIP_SYNC)
 		uint8_t wl_skip_sync=0;
+		#if (RTC_DRIFT)
+			static uint8_t wl_skip_max=WL_SKIP_SYNC; //!< adaptive, depend to sync error
+		#endif
 	#endif
 #endif
 
@@ -369,6 +671,9 @@ void wirelessReceivePacket(void) {
                         rfm_mode = rfmmode_stop;
                         RFM_OFF();
                         RTC_timer_destroy(WL_TIMER_RX_TMO);
+                        #if (WL_GROUP_CMD)
+                        uint8_t * group=NULL;
+                        #endif
 
                         if (rfm_framebuf[0]==0x8b) {
                             wl_force_addr1=rfm_framebuf[5];
@@ -378,7 +683,16 @@ void wirelessReceivePacket(void) {
                             // wl_force_addr2=0xff;
                             memcpy(&wl_force_flags,rfm_framebuf+5,4);
                         } else {
-							#if (WL_SKIP_SYNC)
+                            #if (WL_GROUP_CMD)
+                            // group command, no force (the same for old firmware)
+                            if ((rfm_framebuf[0]==(0x80|(1+4+WL_GROUP_MAX+4)))
+                                && wl_group_time_ok()) {
+                                group=rfm_framebuf+5;
+                            }
+                            #endif
+							#if (WL_SKIP_SYNC) && (RTC_DRIFT)
+								wl_skip_sync=wl_skip_max;
+							#elif (WL_SKIP_SYNC)
 								wl_skip_sync=WL_SKIP_SYNC;
 							#endif
 						}
@@ -392,6 +706,24 @@ void wirelessReceivePacket(void) {
                               place for every rising TOSC1 edge.
                             */
                         }
+                        #if (WL_RX_ADAPTIVE)
+                        wl_rx_learn();
+                        #endif
+                        #if (RTC_DRIFT)
+                        {
+                            int8_t err = (int8_t)(RTC_s256-10); // sync is expected at RTC_s256==10
+                            RTC_DriftSync(err);
+                            #if (WL_SKIP_SYNC)
+                                // RX window is about +-12 steps, keep accumulated error small
+                                if (err<0) err=-err;
+                                if (err<=1) {
+                                    if (wl_skip_max<WL_SKIP_SYNC_MAX) wl_skip_max++;
+                                } else if (err>=3) {
+                                    wl_skip_max>>=1;
+                                }
+                            #endif
+                        }
+                        #endif
                         if (RTC_s256>0x80) {
                             // round to upper number compencastion
                             RTC_s256=4;
@@ -414,31 +746,58 @@ void wirelessReceivePacket(void) {
             			RTC_SetMinute(rfm_framebuf[4]>>1);
             			RTC_SetSecond((rfm_framebuf[4]&1)?30:00);
                         cli(); RTC_timer_done&=~_BV(RTC_TIMER_RTC); sei();  // do not add one second
+                        #if (WL_GROUP_CMD)
+                        if ((group!=NULL) && (group[0]!=wl_group_seq)) {
+                            wl_group_seq=group[0];
+                            if ((group[1]==0) || (group[1] & config.RFM_groups)) {
+                                COM_wireless_group_parse(group+2,WL_GROUP_MAX-2);
+                            }
+                        }
+                        #endif
                         return;
                     }
                 } else 
                 #endif
                 {
+                    #if (WL_FEC)
+                    uint8_t fec=wl_fec_rx();
+                    #endif
                     RTC.pkt_cnt+= (rfm_framepos+7-2-4)/8;
                     mac_ok = cmac_calc(rfm_framebuf+1,rfm_framepos-1-4,(uint8_t*)&RTC,true);
                     RTC.pkt_cnt-= (rfm_framepos+7-2-4)/8;
+                    #if (WL_FEC) && defined(MASTER_CONFIG_H)
+                    if ((!mac_ok) && (fec!=WL_FEC_NONE)) {
+                        // MAC of frame without FEC, clear slave bit if it is ok
+                        wl_fec_revert();
+                        RTC.pkt_cnt+= (rfm_framepos+7-2-4)/8;
+                        if (cmac_calc(rfm_framebuf+1,rfm_framepos-1-4,(uint8_t*)&RTC,true)) {
+                            mac_ok=true;
+                            fec=WL_FEC_NONE;
+                        }
+                        RTC.pkt_cnt-= (rfm_framepos+7-2-4)/8;
+                    }
+                    #endif
+                    #if (WL_FEC)
+                    wl_fec_count(fec,mac_ok);
+                    #endif
                     encrypt_decrypt (rfm_framebuf+2, rfm_framepos-2-4);
                     RTC.pkt_cnt++;
                     COM_dump_packet(rfm_framebuf, rfm_framepos,mac_ok);
                     #if defined(MASTER_CONFIG_H)
 						uint8_t addr = rfm_framebuf[1];
+                        #if (LINKQ) && (WL_FEC)
+                        LQ_rx(addr,mac_ok,fec==WL_FEC_FIXED);
+                        #elif (LINKQ)
+                        LQ_rx(addr,mac_ok,false);
+                        #endif
                         if (mac_ok) {
                           LED_RX_on();
                           RTC_timer_set(RTC_TIMER_RFM, (uint8_t)(RTC_s100 + WLTIME_LED_TIMEOUT));    
-                          q_item_t * p;
-                          uint8_t skip=0;
-                          uint8_t i=0;
-                          while ((p=Q_get(addr,wl_packet_bank, skip++))!=NULL) {
-                              for (i=0;i<(*p).len;i++) {
-                                  wireless_putchar((*p).data[i]);
-                              }
-                          }
-                          wl_packet_bank++;
+                          #if (WL_FEC)
+                          Q_pack(addr,WIRELESS_BUF_MAX-WL_FEC_RESERVE);
+                          #else
+                          Q_pack(addr,WIRELESS_BUF_MAX);
+                          #endif
                           wirelessSendPacket();
                           return;
                         }
@@ -446,6 +805,9 @@ void wirelessReceivePacket(void) {
                         if (mac_ok && (rfm_framebuf[1]==0)) { // Accept commands from master only
                           wireless_buf_ptr=0;
                           RTC_timer_destroy(WL_TIMER_RX_TMO);
+                          #if (WL_RX_ADAPTIVE)
+                          wl_rx_learn();
+                          #endif
                           if (rfm_framepos==4+2) { // empty packet don't need reply
                             rfm_mode = rfmmode_stop;
                             RFM_OFF();
@@ -512,7 +874,11 @@ bool wireless_async = false;
 void wireless_putchar(uint8_t b) {
   if (! wireless_async) {
     // synchronous buffer
+    #if (WL_FEC)
+    if (rfm_framesize<RFM_FRAME_MAX-4-2-WL_FEC_RESERVE) {
+    #else
     if (rfm_framesize<RFM_FRAME_MAX-4-2) {
+    #endif
         rfm_framebuf[rfm_framesize++] = b;
     }
   } else {
@@ -521,7 +887,11 @@ void wireless_putchar(uint8_t b) {
   {
 #endif
     // asynchronous buffer
+    #if (WL_FEC) && !defined(MASTER_CONFIG_H)
+    if (wireless_buf_ptr<WIRELESS_BUF_MAX-WL_FEC_RESERVE) {
+    #else
     if (wireless_buf_ptr<WIRELESS_BUF_MAX) {
+    #endif
         wireless_framebuf[wireless_buf_ptr++] = b;
     }
   }
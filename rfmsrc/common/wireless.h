@@ -44,7 +44,6 @@ void crypto_init(void);
 void wirelessReceivePacket(void);
 #if defined(MASTER_CONFIG_H)
     void wirelessSendSync(void);
-    extern uint8_t wl_packet_bank;
     void wirelessTimer2(void);
 #else
     extern bool wireless_async;
@@ -53,6 +52,21 @@ void wirelessReceivePacket(void);
 void wirelessSendDone(void);
 void wirelessTimer(void);
 
+//! max data bytes in one block command (X/Y config, Q/U timers)
+#define WL_BLOCK_MAX 16
+//! bytes of one motor telemetry record in K reply
+#define WL_MOTOR_LOG_RECORD 15
+
+#if (WL_FEC)
+/* data frame can be followed by 4 bytes of Reed-Solomon parity, 2 interleaved
+ * codewords (even/odd bytes) with 2 parity bytes each, one bad byte in each
+ * codeword is corrected. Length byte include parity. Sync packets are without FEC.
+ */
+#define WL_FEC_BYTES 4
+extern uint16_t wl_fec_fixed;
+extern uint16_t wl_fec_failed;
+#endif
+
 #if (RFM==1)
 void wireless_putchar(uint8_t ch);
 #else
@@ -72,6 +86,7 @@ extern uint32_t wl_force_flags;
 #define WLTIME_TIMEOUT (RTC_TIMER_CALC(80)) // slave RX timeout
 #define WLTIME_SYNC_TIMEOUT (RTC_TIMER_CALC(25)) // slave RX timeout
 #define WLTIME_STOP (RTC_TIMER_CALC(900)) // last possible communication
+#define WLTIME_RX_MARGIN (RTC_TIMER_CALC(12)) // learned RX window margin
 #endif
 #define WLTIME_LED_TIMEOUT (RTC_TIMER_CALC(300)) // packet blink time
 
@@ -79,8 +94,24 @@ extern uint32_t wl_force_flags;
  * it is allowed only if last received sync not contain any communication request
  */  
 #define WL_SKIP_SYNC 3
+#define WL_SKIP_SYNC_MAX 9 // with RTC_DRIFT skip grows up to this limit of master command latency
 extern uint8_t wl_skip_sync;
 
+#if (WL_GROUP_CMD)
+/* group command is sent in sync packet without force addresses, behind time:
+ * seq group cmd param[], group 0 is broadcast, otherwise bitmask of RFM_groups
+ * it is padded to WL_GROUP_MAX, sync length 0x8f is not 0x8b / 0x8d and
+ * firmware without WL_GROUP_CMD handle it as sync without force
+ * it is repeated in WL_GROUP_REPEAT syncs, slaves can skip some of them
+ */
+#define WL_GROUP_MAX 6 // seq group cmd param[3]
+#define WL_GROUP_REPEAT (WL_SKIP_SYNC_MAX+1)
+#if defined(MASTER_CONFIG_H)
+bool wl_group_set(uint8_t group, uint8_t *cmd, uint8_t len);
+bool wl_group_put(void);
+#endif
+#endif
+
 #if !defined(MASTER_CONFIG_H)
 typedef enum {
     WL_TIMER_NONE,
@@ -89,4 +120,10 @@ typedef enum {
     WL_TIMER_SYNC // slave only
 } wirelessTimerCase_t;
 extern wirelessTimerCase_t wirelessTimerCase;
+#if (WL_RX_ADAPTIVE)
+#define WL_RX_SYNC 0
+#define WL_RX_REPLY 1
+#define WL_RX_NONE 0xff
+extern uint8_t wl_rx_tmo[2]; // learned RX windows [WL_RX_SYNC,WL_RX_REPLY]
+#endif
 #endif
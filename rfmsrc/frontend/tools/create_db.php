@@ -36,6 +36,37 @@ $db->query("CREATE TABLE log (
 $db->query("CREATE INDEX log_time_addr on log (time,addr)");
 //$db->query("CREATE INDEX log_time on log (time)");
 
+// ************************************************************
+// latest_status is materialized copy of newest log row per valve,
+// maintained by trigger; seq is log.id and grows with every ingest
+// IF NOT EXISTS allow to run this part on existing database
+
+$db->query("CREATE TABLE IF NOT EXISTS latest_status (
+    addr INTEGER PRIMARY KEY, 
+    seq INTEGER,
+    time INTEGER, 
+    mode CHAR(10),
+    valve INTEGER,
+    real INTEGER,
+    wanted INTEGER,
+    battery INTEGER,
+    error INTEGER DEFAULT 0,
+    window INTEGER DEFAULT 0,
+    force INTEGER DEFAULT 0)");
+
+$db->query("CREATE INDEX IF NOT EXISTS latest_status_seq on latest_status (seq)");
+
+$db->query("CREATE TRIGGER IF NOT EXISTS log_latest_status AFTER INSERT ON log
+    WHEN NOT EXISTS (SELECT 1 FROM latest_status WHERE addr=NEW.addr AND time>NEW.time)
+    BEGIN
+	INSERT OR REPLACE INTO latest_status (addr,seq,time,mode,valve,real,wanted,battery,error,window,force)
+	    VALUES (NEW.addr,NEW.id,NEW.time,NEW.mode,NEW.valve,NEW.real,NEW.wanted,NEW.battery,NEW.error,NEW.window,NEW.force);
+    END");
+
+$db->query("INSERT OR REPLACE INTO latest_status (addr,seq,time,mode,valve,real,wanted,battery,error,window,force)
+    SELECT addr,id,time,mode,valve,real,wanted,battery,error,window,force FROM log
+    WHERE id IN (SELECT max(id) FROM log GROUP BY addr)");
+
 // ************************************************************
 
 $db->query("CREATE TABLE timers (
@@ -86,3 +117,21 @@ $db->query("CREATE TABLE versions (
     addr INTEGER PRIMARY KEY, 
     time INTEGER,
     data char(80))");
+
+// ************************************************************
+
+$db->query("CREATE TABLE link_quality (
+    time INTEGER, 
+    addr INTEGER, 
+    ok INTEGER,
+    mac_err INTEGER,
+    fec INTEGER,
+    rssi INTEGER,
+    afc INTEGER,
+    afc_min INTEGER,
+    afc_max INTEGER,
+    reply0 INTEGER,
+    reply1 INTEGER,
+    reply2 INTEGER,
+    reply3 INTEGER)");
+$db->query("CREATE INDEX link_quality_time_addr on link_quality (time,addr)");
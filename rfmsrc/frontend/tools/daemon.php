@@ -2,38 +2,99 @@
 
 // config part
 $RRD_HOME="/tmp/openhr20/";
+$RRD_FLUSH_INTERVAL=300; // seconds between batched RRD writes
+$RRD_DAEMON=""; // rrdcached address, e.g. "unix:/var/run/rrdcached.sock", empty = direct write
 $TIMEZONE="Europe/Warsaw";
+$GROUP_INTERVAL=360; // seconds between group commands, master repeats one in WL_GROUP_REPEAT (10) syncs
+$LINKQ_INTERVAL=900; // seconds between reading of master link quality table, 0 = disabled
+$RESEND_TIMEOUT=600; // seconds without '*' reply before queued command is sent to master again
 
 // NOTE: this file is hudge dirty hack, will be rewriteln
 echo "OpenHR20 PHP Daemon\n";
 date_default_timezone_set($TIMEZONE);
 $maxDebugLines = 1000;
 
-function weights($char) {
-    $weights_table = array (
-        'D' => 10,
-        'S' => 4,
-        'W' => 4,
-        'G' => 2,
-        'R' => 2,
-	'T' => 2
-    );
-    if (isset($weights_table[$char]))
-        return $weights_table[$char];
-    else 
-        return 10;
+require_once dirname(__FILE__)."/rrd_writer.php";
+$rrd = new rrd_writer($RRD_HOME,$RRD_FLUSH_INTERVAL,$RRD_DAEMON);
+
+function store_value($table,$addr,$idx,$value) {
+    global $db;
+    $db->query("UPDATE $table SET time=".time().",value=$value WHERE addr=$addr AND idx=$idx");
+    $changes=$db->changes();
+    if ($changes==0)
+        $db->query("INSERT INTO $table (time,addr,idx,value) VALUES (".time().",$addr,$idx,$value)");
+}
+
+// signed byte from 2 hex digits
+function hex_s8($s) {
+    $v=hexdec($s);
+    return ($v>127)?$v-256:$v;
+}
+
+// same as _crc_ccitt_update() from avr-libc
+function crc_ccitt_update($crc,$data) {
+    $data ^= $crc & 0xff;
+    $data = ($data ^ ($data<<4)) & 0xff;
+    return ((($data<<8) | ($crc>>8)) ^ ($data>>4) ^ ($data<<3)) & 0xffff;
+}
+
+/*
+ * C reply: compare digests from valve with our copy in eeprom/timers tables
+ * and queue block reads only for config / timer days which differ
+ */
+function digest_sync($addr,$size,$digests) {
+    global $db;
+    $cmd=array();
+    $eeprom=array();
+    $result=$db->query("SELECT idx,value FROM eeprom WHERE addr=$addr");
+    while ($row=$result->fetchArray()) $eeprom[$row['idx']]=$row['value'];
+    $crc=0xffff;
+    for ($i=0; $i<$size; $i++) {
+        if (!isset($eeprom[$i])) { $crc=-1; break; }
+        $crc=crc_ccitt_update($crc,$eeprom[$i]);
+    }
+    if ($crc!=hexdec(substr($digests,0,4))) {
+        for ($i=0; $i<$size; $i+=16) $cmd[]=sprintf("X%02x%02x",$i,min(16,$size-$i));
+    }
+    $timers=array();
+    $result=$db->query("SELECT idx,value FROM timers WHERE addr=$addr");
+    while ($row=$result->fetchArray()) $timers[$row['idx']]=$row['value'];
+    for ($d=0; $d<8; $d++) {
+        $crc=0xffff;
+        for ($s=0; $s<8; $s++) {
+            if (!isset($timers[$d*16+$s])) { $crc=-1; break; }
+            $crc=crc_ccitt_update($crc,$timers[$d*16+$s]>>8);
+            $crc=crc_ccitt_update($crc,$timers[$d*16+$s]&0xff);
+        }
+        if ($crc!=hexdec(substr($digests,4+$d*4,4))) $cmd[]=sprintf("Q%x0%02x",$d,8);
+    }
+    foreach ($cmd as $c) {
+        // same request can be in queue already
+        if ($db->querySingle("SELECT count(*) FROM command_queue WHERE addr=$addr AND data='$c'")==0)
+            $db->query("INSERT INTO command_queue (time,addr,data) VALUES (".time().",$addr,'$c')");
+    }
+    echo " digest: ".count($cmd)." block reads queued\n";
 }
 
 $db = new SQLite3("/tmp/openhr20.sqlite");
 $db->query("PRAGMA synchronous=OFF");
 
+// master use XON/XOFF flow control (COM_FLOW_XONXOFF in master config.h),
+// tty must stop sending on XOFF, serial to TCP bridges need same setting
+// "E" command print its buffer overflow counters and high-water marks
+$tty="/dev/ttyUSB0";
 //$fp=fsockopen("192.168.62.230",3531);
 //$fp=fopen("php://stdin","r"); 
-$fp=fopen("/dev/ttyUSB0","w+"); 
+exec("stty -F $tty 38400 raw -echo ixon", $out, $ret);
+if ($ret!=0) die("stty $tty failed\n");
+$fp=fopen($tty,"w+"); 
 
 //while(($line=stream_get_line($fp,256,"\n"))!=FALSE) {
 
 $addr=-1;
+$group_sent=0;
+$linkq_sent=0;
+$linkq_next=0;
 
 while(($line=fgets($fp,256))!==FALSE) {
     $line=trim($line);
@@ -51,9 +112,10 @@ while(($line=fgets($fp,256))!==FALSE) {
        }
 
     } else if ($line{0}=='*') {
-	   $db->query("DELETE FROM command_queue WHERE id=(SELECT id FROM command_queue WHERE addr=$addr AND send>0 ORDER BY send LIMIT 1)");
-	   $force=true;
        $data = substr($line,1);
+	   // master reorders commands by priority, reply belongs to oldest sent command with same letter
+	   $db->query("DELETE FROM command_queue WHERE id=(SELECT id FROM command_queue WHERE addr=$addr AND send>0 AND substr(data,1,1)='".$data{0}."' ORDER BY send,id LIMIT 1)");
+	   $force=true;
     } else if ($line{0}=='-') {
 	   $data = substr($line,1);
     } else if ($line=='}') { 
@@ -77,6 +139,17 @@ while(($line=fgets($fp,256))!==FALSE) {
     	$debug=false;
     } else if (($line=="OK") || (($line{0}=='d') && ($line{2}==' '))) {
         $debug=false;
+    } else if (($line{0}=='I') && ($line{1}=='[') && ($line{4}==']')) {
+        // link quality of one slave: ok mac_err fec rssi afc afc_min afc_max reply histogram
+        $v=explode(' ',substr($line,6));
+        if ((count($v)==8) && (hexdec($v[0])+hexdec($v[1])>0)) {
+            $db->query(sprintf("INSERT INTO link_quality (time,addr,ok,mac_err,fec,rssi,afc,afc_min,afc_max,reply0,reply1,reply2,reply3)"
+                ." VALUES (%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d)",
+                time(),hexdec(substr($line,2,2)),hexdec($v[0]),hexdec($v[1]),hexdec($v[2]),hexdec($v[3]),
+                hex_s8($v[4]),hex_s8($v[5]),hex_s8($v[6]),
+                hexdec(substr($v[7],0,2)),hexdec(substr($v[7],2,2)),hexdec(substr($v[7],4,2)),hexdec(substr($v[7],6,2))));
+        }
+        $debug=false;
     } else if (($line=="N0?") || ($line=="N1?")) {
         $result = $db->query("SELECT addr,count(*) AS c FROM command_queue GROUP BY addr ORDER BY c");
         // $result = $db->query("SELECT addr,count(*) AS c FROM command_queue WHERE send=0 GROUP BY addr ORDER BY c");
@@ -98,6 +171,27 @@ while(($line=fgets($fp,256))!==FALSE) {
         if (!isset($v)) $v = sprintf("P%02x%02x%02x%02x\n",$req[0],$req[1],$req[2],$req[3]);
         echo $v; fwrite($fp,$v);
         //fwrite($fp,"P14000000\n");
+        // group commands are in command_queue with addr 256+group mask (256 = all valves)
+        if (time()-$group_sent>=$GROUP_INTERVAL) {
+            $row=$db->querySingle("SELECT id,addr,data FROM command_queue WHERE addr>=256 ORDER BY time LIMIT 1",true);
+            if ($row) {
+                $g=sprintf("{%02x}%s\n",$row['addr']-256,$row['data']);
+                echo $g; fwrite($fp,$g);
+                $db->query("DELETE FROM command_queue WHERE id=".$row['id']);
+                $group_sent=time();
+            }
+        }
+        // link quality table is read and cleared 8 slaves per request
+        if (($LINKQ_INTERVAL>0) && (($linkq_next>0) || (time()-$linkq_sent>=$LINKQ_INTERVAL))) {
+            if ($linkq_next==0) {
+                $linkq_next=1;
+                $linkq_sent=time();
+            }
+            $l=sprintf("I%02x88\n",$linkq_next);
+            echo $l; fwrite($fp,$l);
+            $linkq_next+=8;
+            if ($linkq_next>=30) $linkq_next=0;
+        }
         $debug=false;
     } else {
     	if ($addr>0) {
@@ -105,24 +199,18 @@ while(($line=fgets($fp,256))!==FALSE) {
     	    $debug=false;
     	    // echo "data req addr $addr\n";
     	    $db->query("BEGIN TRANSACTION");
-    	    $result = $db->query("SELECT id,data FROM command_queue WHERE addr=".($addr&0x7f)." ORDER BY time LIMIT 25");
-    	    $weight=0;
-    	    $bank=0;
-    	    $send=0;
+    	    // send=0 not sent yet, otherwise time of sending, command waits for '*' reply
+    	    // in master queue, it is sent again only after $RESEND_TIMEOUT
+    	    $now=time();
+    	    $result = $db->query("SELECT id,data FROM command_queue WHERE addr=".($addr&0x7f)
+    	        ." AND (send=0 OR send<".($now-$RESEND_TIMEOUT).") ORDER BY time LIMIT 25");
     	    $q='';
     	    while ($row = $result->fetchArray()) {
-    	       $cw = weights($row['data']{0});
-    	       $weight += $cw;
-               weights($row['data']{0});
-    	       if ($weight>10) {
-                    if (++$bank>=7) break;
-                    $weight=$cw;
-               }
-    	       $r = sprintf("(%02x-%x)%s\n",$addr,$bank,$row['data']);
+    	       // master packs commands to packets itself (priority and exact sizes), bank is not used
+    	       $r = sprintf("(%02x-0)%s\n",$addr,$row['data']);
     	       $q.=$r;
                echo $r;
-               $send++;
-               $db->query("UPDATE command_queue SET send=$send WHERE id=".$row['id']);
+               $db->query("UPDATE command_queue SET send=$now WHERE id=".$row['id']);
             }
             fwrite($fp,$q);
     	    $db->query("COMMIT");
@@ -131,11 +219,18 @@ while(($line=fgets($fp,256))!==FALSE) {
     	  } else if ($data{1}=='[' && $data{4}==']' && $data{5}=='=') {
     	    $idx=hexdec(substr($data,2,2));
     	    $value=hexdec(substr($data,6));
+    	    $width=0; // digits of one value in block reply, 0 = single value
     	    switch ($data{0}) {
+    	    case 'X':
+    	    case 'Y':
+    		$width=2;
     	    case 'G':
     	    case 'S':
     		$table='eeprom';
     		break;
+    	    case 'Q':
+    	    case 'U':
+    		$width=4;
     	    case 'R':
     	    case 'W':
     		$table='timers';
@@ -146,12 +241,20 @@ while(($line=fgets($fp,256))!==FALSE) {
     	    default:
     		$table=null;
     	    }
+    	    if ($data{0}=='C') {
+    	      digest_sync($addr,$idx,substr($data,6));
+    	    }
     	    echo " table $table\n";
     	    if ($table!==null) {
-    	      $db->query("UPDATE $table SET time=".time().",value=$value WHERE addr=$addr AND idx=$idx");
-    	      $changes=$db->changes();
-    	      if ($changes==0)
-    	        $db->query("INSERT INTO $table (time,addr,idx,value) VALUES (".time().",$addr,$idx,$value)");
+    	      if ($width>0) {
+    	        // block X[start]=v0v1.. / Q[day slot]=w0w1..
+    	        $values=substr($data,6);
+    	        for ($i=0; $i*$width<strlen($values); $i++) {
+    	          store_value($table,$addr,$idx+$i,hexdec(substr($values,$i*$width,$width)));
+    	        }
+    	      } else {
+    	        store_value($table,$addr,$idx,$value);
+    	      }
     	    }
     	  } else if ($data{0}=='V') {
     	      $db->query("UPDATE versions SET time=".time().",data='$data' WHERE addr=$addr");
@@ -214,12 +317,7 @@ while(($line=fgets($fp,256))!==FALSE) {
             if (($time % 3600)<$t) $time-=3600;
             $time = (int)($time/3600)*3600+$t;
         	$db->query("INSERT INTO log (time,addr$vars) VALUES ($time,$addr$val)\n");
-		$rrd_file = $RRD_HOME."/openhr20_".$addr.".rrd";
-		if (file_exists ($rrd_file)) {
-        		$cmnd = "rrdtool update ".$rrd_file." ".$time.":".(int)$st['real'].":".(int)$st['wanted'].":".(int)$st['valve'].":".(int)$st['window'];
-        		echo $cmnd."\n";
-			system($cmnd); 
-		}
+		$rrd->update($addr,$time,array((int)$st['real'],(int)$st['wanted'],(int)$st['valve'],(int)$st['window']));
     	  }
     	}
     }
@@ -231,5 +329,6 @@ while(($line=fgets($fp,256))!==FALSE) {
 	$deleteThld = $db->lastInsertRowid()-$maxDebugLines;
 	$db->query("DELETE FROM debug_log WHERE id<$deleteThld");	
     }
+    $rrd->poll(); // batched RRD writes, never blocks serial handling
 	// echo "         duration ".(microtime(true)-$ts)."\n";
 } 
@@ -0,0 +1,117 @@
+<?php
+
+/*
+ * Batched RRD writer for daemon.php
+ *
+ * Samples are buffered per RRD file and written in one "update" command per
+ * file every $interval seconds. Commands go to a single long running
+ * "rrdtool -" process (pipe mode), so the serial loop never forks and never
+ * waits for disk I/O. If $daemon is set (e.g. "unix:/var/run/rrdcached.sock")
+ * the updates are passed to rrdcached, which batches the disk writes too.
+ */
+
+class rrd_writer {
+  private $home;
+  private $interval;
+  private $daemon;
+  private $pending = array();   // file => array(time => "t:v:v:v:v")
+  private $last = array();      // file => last timestamp handed to rrdtool
+  private $last_flush;
+  private $proc = null;
+  private $pipe = null;
+  private $backlog = '';        // bytes not yet accepted by the pipe
+
+  function __construct($home, $interval = 300, $daemon = '') {
+    $this->home = $home;
+    $this->interval = $interval;
+    $this->daemon = $daemon;
+    $this->last_flush = time();
+  }
+
+  function __destruct() {
+    $this->flush();
+    $this->close();
+  }
+
+  private function file_name($addr) {
+    return $this->home."/openhr20_".$addr.".rrd";
+  }
+
+  /*
+   * queue one sample, values in RRD DS order (real, wanted, valve, window)
+   */
+  public function update($addr, $time, $values) {
+    $file = $this->file_name($addr);
+    // rrdtool rejects non increasing timestamps, newer line for same time wins
+    if (isset($this->last[$file]) && $time <= $this->last[$file]) return;
+    $this->pending[$file][$time] = $time.":".implode(":", $values);
+  }
+
+  /*
+   * call it from main loop, it flushes only when interval expired
+   */
+  public function poll() {
+    if ($this->backlog != '') $this->write('');
+    if (time() - $this->last_flush >= $this->interval) $this->flush();
+  }
+
+  public function flush() {
+    $this->last_flush = time();
+    if (count($this->pending) == 0) return;
+    $cmd = '';
+    foreach ($this->pending as $file => $samples) {
+      if (!file_exists($file)) continue; // RRD not created for this valve
+      ksort($samples);
+      $cmd .= "update ";
+      if ($this->daemon != '') $cmd .= "--daemon ".$this->daemon." ";
+      $cmd .= $file." ".implode(" ", $samples)."\n";
+      end($samples);
+      $this->last[$file] = key($samples);
+    }
+    $this->pending = array();
+    if ($cmd != '') {
+      echo " rrd flush ".strlen($cmd)." bytes\n";
+      $this->write($cmd);
+    }
+  }
+
+  private function open() {
+    $spec = array(
+      0 => array("pipe", "r"),
+      1 => array("file", "/dev/null", "w"), // "OK u:.. s:.." replies are not needed
+      2 => array("file", "/dev/null", "w")
+    );
+    $this->proc = proc_open("rrdtool -", $spec, $pipes);
+    if (!is_resource($this->proc)) {
+      $this->proc = null;
+      return false;
+    }
+    $this->pipe = $pipes[0];
+    stream_set_blocking($this->pipe, false);
+    return true;
+  }
+
+  private function close() {
+    if ($this->pipe !== null) fclose($this->pipe);
+    if ($this->proc !== null) proc_close($this->proc);
+    $this->pipe = null;
+    $this->proc = null;
+  }
+
+  private function write($cmd) {
+    if ($this->proc !== null) {
+      $st = proc_get_status($this->proc);
+      if (!$st['running']) $this->close(); // rrdtool died, restart it
+    }
+    if ($this->proc === null && !$this->open()) {
+      echo " rrd: can't start rrdtool\n";
+      $this->backlog = '';
+      return;
+    }
+    $this->backlog .= $cmd;
+    $n = fwrite($this->pipe, $this->backlog);
+    if ($n === false) $n = 0;
+    // pipe full, rest is written on next poll()
+    $this->backlog = (string)substr($this->backlog, $n);
+  }
+}
@@ -0,0 +1,133 @@
+<?php
+
+/*
+ * Fit valve characteristic (config valve_curve1..7) from log table
+ *
+ * usage: php valvefit.php <addr> [days] [queue]
+ *
+ * Real valves open most of the flow in first part of stroke, so linear
+ * stroke makes controller gain much higher at small output. Logged
+ * temperature slope after each status line is used as flow estimation:
+ * it is binned by valve stroke (logged output mapped through the curve
+ * valve is running now), slope of closed valve is heat loss and it is
+ * subtracted, result is forced to be rising and normalized to 0..1.
+ * New curve is stroke where estimated flow is 1/8, 2/8 ... 7/8.
+ *
+ * With "queue" the S commands are put to command_queue, otherwise only printed.
+ */
+
+$DB_FILE="/tmp/openhr20.sqlite";
+$LAYOUTS=dirname(__FILE__)."/../www/ee_layouts/";
+$BINS=10;          // stroke bins, 10% each
+$MIN_SAMPLES=20;   // bins with less samples are interpolated
+$MIN_DT=60;        // status lines closer/further than this are not used
+$MAX_DT=1200;
+
+if ($argc<2) {
+  echo "usage: php valvefit.php <addr> [days] [queue]\n";
+  exit(1);
+}
+$addr=(int)$argv[1];
+$days=($argc>2)?(int)$argv[2]:14;
+$queue=($argc>3 && $argv[3]=="queue");
+
+$db = new SQLite3($DB_FILE);
+
+$layout=$db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=255");
+if ($layout===null) {
+  echo "no eeprom layout for $addr, read eeprom first\n";
+  exit(1);
+}
+include $LAYOUTS.sprintf("%02x",$layout).".php";
+if (!isset($layout_names['valve_curve1'])) {
+  echo sprintf("layout %02x has no valve_curve, firmware without VALVE_CURVE\n",$layout);
+  exit(1);
+}
+
+// curve running in valve, points for output 0, 12.5 ... 100%
+$curve=array(0);
+for ($i=1;$i<8;$i++) {
+  $idx=$layout_names['valve_curve'.$i];
+  $v=$db->querySingle("SELECT value FROM eeprom WHERE addr=$addr AND idx=$idx");
+  $curve[$i]=($v===null)?round($i*100/8):$v;
+}
+$curve[8]=100;
+
+// same as MOTOR_valve_curve() in firmware
+function stroke($curve,$percent) {
+  $x=$percent*8/100;
+  $k=min((int)$x,7);
+  return $curve[$k]+($curve[$k+1]-$curve[$k])*($x-$k);
+}
+
+$sum=array_fill(0,$BINS+1,0.0);
+$cnt=array_fill(0,$BINS+1,0);
+$prev=null;
+$result=$db->query("SELECT time,valve,real,window FROM log WHERE addr=$addr AND time>"
+    .(time()-$days*86400)." AND real>0 ORDER BY time");
+while ($row=$result->fetchArray(SQLITE3_ASSOC)) {
+  if ($prev!==null && !$prev['window'] && !$row['window']) {
+    $dt=$row['time']-$prev['time'];
+    if ($dt>=$MIN_DT && $dt<=$MAX_DT) {
+      // real is in 1/100 C, slope in C/hour
+      $b=(int)round(stroke($curve,$prev['valve'])*$BINS/100);
+      $sum[$b]+=($row['real']-$prev['real'])/100*3600/$dt;
+      $cnt[$b]++;
+    }
+  }
+  $prev=$row;
+}
+
+// mean per bin, closed valve is reference
+if ($cnt[0]<$MIN_SAMPLES) {
+  echo "not enough samples with closed valve ($cnt[0])\n";
+  exit(1);
+}
+$pts=array();
+for ($b=0;$b<=$BINS;$b++) {
+  printf("stroke %3d%%: %5d samples",$b*100/$BINS,$cnt[$b]);
+  if ($cnt[$b]>=$MIN_SAMPLES) {
+    $pts[]=array('s'=>$b*100/$BINS,'f'=>$sum[$b]/$cnt[$b]-$sum[0]/$cnt[0],'w'=>$cnt[$b]);
+    printf(" %+6.2f C/h",$sum[$b]/$cnt[$b]);
+  }
+  echo "\n";
+}
+
+// pool adjacent violators, flow must rise with stroke
+for ($i=1;$i<count($pts);) {
+  if ($pts[$i]['f']>=$pts[$i-1]['f']) { $i++; continue; }
+  $w=$pts[$i]['w']+$pts[$i-1]['w'];
+  $f=($pts[$i]['f']*$pts[$i]['w']+$pts[$i-1]['f']*$pts[$i-1]['w'])/$w;
+  $pts[$i-1]=array('s'=>($pts[$i]['s']+$pts[$i-1]['s'])/2,'f'=>$f,'w'=>$w);
+  array_splice($pts,$i,1);
+  if ($i>1) $i--;
+}
+$max=$pts[count($pts)-1]['f'];
+if (count($pts)<3 || $max<=0) {
+  echo "not enough data with open valve\n";
+  exit(1);
+}
+// full stroke is full flow, bins behind last usable one are extrapolated so
+if ($pts[count($pts)-1]['s']<100) $pts[]=array('s'=>100,'f'=>$max,'w'=>0);
+
+// invert: stroke for flow i/8
+$cmd=array();
+$j=1;
+$last=0;
+for ($i=1;$i<8;$i++) {
+  $f=$max*$i/8;
+  while ($j<count($pts)-1 && $pts[$j]['f']<$f) $j++;
+  $a=$pts[$j-1]; $b=$pts[$j];
+  $s=($b['f']>$a['f'])?$a['s']+($b['s']-$a['s'])*($f-$a['f'])/($b['f']-$a['f']):$b['s'];
+  $s=max($last,min(100,(int)round($s)));
+  $last=$s;
+  $idx=$layout_names['valve_curve'.$i];
+  printf("valve_curve%d: %3d -> %3d\n",$i,$curve[$i],$s);
+  if ($s!=$curve[$i]) $cmd[]=sprintf("S%02x%02x",$idx,$s);
+}
+
+foreach ($cmd as $c) {
+  echo "$c\n";
+  if ($queue)
+    $db->query("INSERT INTO command_queue (time,addr,data) VALUES (".time().",$addr,'$c')");
+}
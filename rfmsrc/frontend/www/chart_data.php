@@ -0,0 +1,84 @@
+<?php
+
+/*
+ * downsampled chart data for flot (see contend/status.php)
+ *
+ *  chart_data.php?addr=A&hours=H&points=P
+ *
+ * log rows are averaged into P buckets over last H hours, window open state
+ * is returned as flot markings. Output is cached per time bucket, so all
+ * page views inside one bucket share the same file and SQLite is asked once.
+ */
+
+include "common.php";
+
+$CHART_CACHE_DIR = sys_get_temp_dir();
+
+$addr = (int)$_GET['addr'];
+$hours = isset($_GET['hours']) ? (int)$_GET['hours'] : $chart_hours;
+if ($hours <= 0) $hours = $chart_hours;
+$points = isset($_GET['points']) ? (int)$_GET['points'] : 400;
+if ($points < 10) $points = 10;
+if ($points > 2000) $points = 2000;
+
+$bucket = (int)ceil($hours*3600/$points);  // seconds per point
+$now = time();
+$slot = (int)($now/$bucket);
+$prefix = "$CHART_CACHE_DIR/openhr20_chart_{$addr}_{$hours}_{$bucket}_";
+$cache = $prefix.$slot.".json";
+
+header("Content-Type: application/json");
+header("Cache-Control: max-age=".($bucket - $now % $bucket));
+
+if (file_exists($cache)) {
+  readfile($cache);
+  exit;
+}
+
+$off = date_offset_get(new DateTime);
+$min_time = $slot*$bucket - $hours*3600;
+
+$result = $db->query("SELECT time,real,wanted,valve,window FROM log WHERE addr=$addr AND time>$min_time ORDER BY time");
+
+// accumulate rows per bucket, memory is bounded by $points
+$acc = array();
+while ($row = $result->fetchArray(SQLITE3_ASSOC)) {
+  $rb = (int)($row['time']/$bucket);
+  if (!isset($acc[$rb])) $acc[$rb] = array(0, 0, 0, 0, 0);
+  $acc[$rb][0]++;
+  $acc[$rb][1] += $row['real'];
+  $acc[$rb][2] += $row['wanted'];
+  $acc[$rb][3] += $row['valve'];
+  if ($row['window']) $acc[$rb][4] = 1;
+}
+
+$real = array(); $wanted = array(); $valve = array(); $markings = array();
+$window = -1; $win_pos = 0; $t = 0;
+foreach ($acc as $rb => $a) {
+  $t = ($rb*$bucket + $bucket/2 + $off)*1000;
+  $real[] = array($t, round($a[1]/$a[0]/100, 2));
+  $wanted[] = array($t, round($a[2]/$a[0]/100, 2));
+  $valve[] = array($t, round($a[3]/$a[0]));
+  if ($window != $a[4]) {
+    if ($window == 1) {
+      $markings[] = array('xaxis' => array('from' => $win_pos, 'to' => $t), 'color' => '#e0e0ff');
+    }
+    $window = $a[4];
+    $win_pos = $t;
+  }
+}
+if ($window == 1) {
+  $markings[] = array('xaxis' => array('from' => $win_pos, 'to' => $t), 'color' => '#e0e0ff');
+}
+
+$out = json_encode(array(
+  'real' => $real,
+  'wanted' => $wanted,
+  'valve' => $valve,
+  'markings' => $markings
+));
+echo $out;
+
+// replace cache of previous time bucket
+foreach (glob($prefix."*.json") as $f) @unlink($f);
+if (@file_put_contents($cache.".tmp", $out) !== false) @rename($cache.".tmp", $cache);
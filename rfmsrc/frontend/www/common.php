@@ -23,6 +23,22 @@ function get_config ($layout_names,$addr, $id) {
   return "NA";
 }
 
+// newest status row of all valves, one query (see latest_status in create_db.php)
+function get_latest_status () {
+  global $db;
+  $ret = array();
+  $result = $db->query("SELECT * FROM latest_status");
+  while ($row = $result->fetchArray(SQLITE3_ASSOC)) {
+    $ret[$row['addr']] = $row;
+  }
+  return $ret;
+}
+
+function get_latest_seq () {
+  global $db;
+  return (int)$db->querySingle("SELECT max(seq) FROM latest_status");
+}
+
 
 class contend {
   protected $addr;
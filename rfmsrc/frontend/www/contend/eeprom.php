@@ -25,6 +25,7 @@ class contend_eeprom extends contend {
     $result = $db->query("SELECT * FROM eeprom WHERE addr=$this->addr ORDER BY addr,idx");
 
     echo ('<div><a href="?page=queue&read_eeprom=1&addr='.$this->addr.'">Make refresh requests for all values</a></div>');
+    echo ('<div><a href="?page=queue&sync=1&addr='.$this->addr.'">Make refresh requests for changed values only</a></div>');
     
     echo '<form method="post" action="?page=eeprom&amp;addr='.$this->addr.'" /><table>';
 
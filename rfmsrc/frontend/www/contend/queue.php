@@ -28,21 +28,25 @@ class contend_queue extends contend {
       $cmd = array();
       // timmers
 
+      // block reads, one command per weekday / 16 bytes of eeprom
       if ($_GET['read_timers']==1) {
 	for ($i=0; $i<8; $i++) {
-	    for ($j=0; $j<8; $j++) {
-		$cmd[]="R$i$j";
-	    }
+	    $cmd[] = sprintf ("Q%x0%02x",$i,8);
 	}
       }
 
       if ($_GET['read_eeprom']==1) {
 	$cmd[] = "Gff";
-	for ($i=0; $i<0x32; $i++) {
-	    $cmd[] = sprintf ("G%02x",$i);
+	for ($i=0; $i<0x32; $i+=16) {
+	    $cmd[] = sprintf ("X%02x%02x",$i,min(16,0x32-$i));
 	}
       }
 
+      // digests only, daemon queues block reads for changed parts
+      if ($_GET['sync']==1) {
+	$cmd[] = "C";
+      }
+
       if ($_GET['read_trace']==1) {
 	$cmd[] = "Tff";
 	for ($i=0; $i<=0x0d; $i++) {
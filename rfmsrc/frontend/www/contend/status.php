@@ -29,9 +29,10 @@ class contend_status extends contend {
 	}
       }  
     } else if ($_POST['type'] == 'all') {
+      $latest = get_latest_status();
       foreach ($room_name as $k=>$v) {
-	$result = $db->query("SELECT * FROM log WHERE addr=$k ORDER BY time DESC LIMIT 1");
-	if ($row = $result->fetchArray()) {
+	if (isset($latest[$k])) {
+	  $row = $latest[$k];
 	  if ((isset($_POST["auto_mode_$k"]) && ($row['mode']!=$_POST["auto_mode_$k"]))) {
 	    switch ($_POST["auto_mode_$k"]) {
 	      case 'AUTO':
@@ -90,40 +91,9 @@ class contend_status extends contend {
       <script id="source" language="javascript" type="text/javascript">
       document.write("<div id=\"chart\" style=\"width:800px;height:400px;\"></div>");
       $(function () {
-	<?php
-	    $now = time();
-	    $min_time = $now-$chart_hours*60*60;
-	    
-	    $result = $db->query("SELECT * FROM log WHERE addr=$this->addr AND time>$min_time ORDER BY time");    
-	    $real=array();$wanted=array();$valve=array();$markings=array();
-	    $off=date_offset_get(new DateTime);
-	    $window=-1; $win_pos=0;
-	    while ($row = $result->fetchArray()) {                                                                                            
-		$t = ($row['time']+$off)."000";
-	        array_push($real,array($t,$row['real']/100));                                                                              
-	        array_push($wanted,array($t,$row['wanted']/100));                                                                              
-	        array_push($valve,array($t,$row['valve']));                                                                              
-		if ($window != $row['window']) {
-		    if ($window == 1) {
-		    	array_push($markings,
-			    array('xaxis' => array ( 'from' => $win_pos , 'to' => $t ),
-			    'color' => '#e0e0ff'));
-		    }
-		    $window = $row['window'];
-		    $win_pos = $t;
-		}
-	    }       
-	    if ($window == 1) {
-	    	array_push($markings,
-		    array('xaxis' => array ( 'from' => $win_pos , 'to' => $t ),
-		    'color' => '#e0e0ff'));
-	    }
-	    echo "var real = ". json_encode($real).";\n";
-	    echo "var wanted = ". json_encode($wanted).";\n";
-	    echo "var valve = ". json_encode($valve).";\n";
-	    echo "var markings = ". json_encode($markings).";\n";
-	    
-	?>
+	// data are downsampled and cached per time bucket by chart_data.php
+	$.getJSON("chart_data.php?addr=<?php echo $this->addr; ?>&hours=<?php echo $chart_hours; ?>", function (d) {
+	    var real = d.real, wanted = d.wanted, valve = d.valve, markings = d.markings;
 	    var chart=$("#chart");
 	    var data= [{ data: wanted , label: "Wanted temp.", unit: "॰C "},
 	         { data: real, label: "Real temp." , unit: "॰C" },
@@ -180,6 +150,7 @@ class contend_status extends contend {
 			previousPoint = null;
 		    }
 	    });
+	    });
 	});
       </script>												   
 	      
@@ -193,17 +164,16 @@ class contend_status extends contend {
       }
 
     } else {
-//	this SELECT is teoreticaly best practice, but unaceptable slow
-//      $result = $db->query("SELECT * FROM log WHERE id IN (SELECT min(id) from log GROUP BY addr) ORDER BY addr");
-//      $result = $db->query("SELECT * FROM log l,(SELECT min(id) AS m from log GROUP BY addr) AS m WHERE m.m=l.id");
+//	one query for all valves, latest_status table is maintained by trigger on log
+	$latest = get_latest_status();
       
 	echo '<form method="post" action="?page=status&amp;addr='.$this->addr.'" /><table>';
 	echo '<tr><th>valve</th><th>Last update</th><th>Mode</th><th>Valve [%]</th><th>Real [&deg;C]</th>'
 	    .'<th>Wanted [&deg;C]</th><th>Battery</th><th>Error</th><th>Window</th></tr>';
 	foreach ($room_name as $k=>$v) {
-	  $result = $db->query("SELECT * FROM log WHERE addr=$k ORDER BY time DESC LIMIT 1");
 	  echo "<tr><td><a href=\"?page=status&amp;addr=$k\">$v</a></td>";
-	  if ($row = $result->fetchArray()) {
+	  if (isset($latest[$k])) {
+	    $row = $latest[$k];
 	    $age=time()-$row['time'];
 	    if ($age > $GLOBALS['error_age']) {
         $age_t=' class="error"';
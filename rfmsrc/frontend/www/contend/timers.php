@@ -116,6 +116,7 @@ class contend_timers extends contend {
       global $db,$timer_names,$symbols;
 
       echo ('<div><a href="?page=queue&read_timers=1&read_eeprom=1&addr='.$this->addr.'">Make refresh requests for all values</a></div>');
+      echo ('<div><a href="?page=queue&sync=1&addr='.$this->addr.'">Make refresh requests for changed values only</a></div>');
       echo '<form method="post" action="?page=timers&amp;addr='.$this->addr.'" />';
       
       echo "<h2>Preset temperatures</h2><table><tr>";
@@ -0,0 +1,59 @@
+<?php
+
+/*
+ * latest state of all valves as JSON
+ *
+ *  status_json.php               - current state, supports If-None-Match
+ *  status_json.php?since=N       - long poll, wait until ingest sequence > N
+ *  status_json.php?since=N&timeout=T - long poll with own timeout [s]
+ *
+ * ETag and "seq" are the ingest sequence (log.id of newest status row),
+ * client send back "seq" as "since" in next request
+ */
+
+include "common.php";
+
+$LONG_POLL_MAX = 55; // seconds, keep it below web server timeout
+
+$seq = get_latest_seq();
+
+if (isset($_GET['since'])) {
+  $since = (int)$_GET['since'];
+  $timeout = isset($_GET['timeout']) ? (int)$_GET['timeout'] : 25;
+  if ($timeout < 0) $timeout = 0;
+  if ($timeout > $LONG_POLL_MAX) $timeout = $LONG_POLL_MAX;
+  set_time_limit($timeout + 10);
+  $end = time() + $timeout;
+  while (($seq <= $since) && (time() < $end)) {
+    sleep(1);
+    $seq = get_latest_seq();
+  }
+}
+
+$etag = '"'.$seq.'"';
+header("Cache-Control: no-cache");
+header("ETag: $etag");
+if (isset($_SERVER['HTTP_IF_NONE_MATCH']) && (trim($_SERVER['HTTP_IF_NONE_MATCH']) == $etag)) {
+  header("HTTP/1.1 304 Not Modified");
+  exit;
+}
+
+$valves = array();
+foreach (get_latest_status() as $addr => $row) {
+  $valves[] = array (
+    'addr'    => (int)$addr,
+    'name'    => isset($room_name[$addr]) ? $room_name[$addr] : (string)$addr,
+    'seq'     => (int)$row['seq'],
+    'time'    => (int)$row['time'],
+    'mode'    => $row['mode'],
+    'valve'   => (int)$row['valve'],
+    'real'    => $row['real']/100,
+    'wanted'  => $row['wanted']/100,
+    'battery' => $row['battery']/1000,
+    'error'   => (int)$row['error'],
+    'window'  => (int)$row['window']
+  );
+}
+
+header("Content-Type: application/json");
+echo json_encode(array('seq' => $seq, 'time' => time(), 'valves' => $valves));
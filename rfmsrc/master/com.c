@@ -47,6 +47,7 @@
 #include "task.h"
 #include "eeprom.h"
 #include "queue.h"
+#include "linkq.h"
 
 
 #if defined(_AVR_IOM32_H_) || defined(__AVR_ATmega328P__)
@@ -69,6 +70,19 @@ static char rx_buff[RX_BUFF_SIZE];
 static uint8_t rx_buff_in=0;
 static uint8_t rx_buff_out=0;
 
+#define XON 0x11
+#define XOFF 0x13
+#define RX_XOFF_FREE 16  // send XOFF when less space is free in rx_buff
+#define RX_XON_FREE 32   // send XON when this space is free again
+
+#if COM_FLOW_XONXOFF
+static volatile char flow_send=0;  // XON/XOFF to send before tx_buff
+static bool rx_stopped=false;      // XOFF is sent to host
+static volatile bool tx_stopped=false; // host sent XOFF
+#endif
+
+com_stat_t COM_stat; // overflow counters and high-water marks
+
 extern uint8_t onsync;
 
 /*!
@@ -82,7 +96,10 @@ static void COM_putchar(char c) {
 	if ((tx_buff_in+1)%TX_BUFF_SIZE!=tx_buff_out) {
 		tx_buff[tx_buff_in++]=c;
 		tx_buff_in%=TX_BUFF_SIZE;
+		uint16_t used=(tx_buff_in-tx_buff_out+TX_BUFF_SIZE)%TX_BUFF_SIZE;
+		if (used>COM_stat.tx_high) COM_stat.tx_high=used;
 	} else {
+	   if (COM_stat.tx_overflow!=0xffff) COM_stat.tx_overflow++;
 	   // mark end on buffer owerflow to recognize this situation
 	   if (tx_buff_in==0) {
             tx_buff[TX_BUFF_SIZE-2]='*';
@@ -107,6 +124,14 @@ static void COM_putchar(char c) {
 char COM_tx_char_isr(void) {
 	wdt_reset();
     char c='\0';
+#if COM_FLOW_XONXOFF
+	if (flow_send!='\0') {
+		c=flow_send;
+		flow_send='\0';
+		return c;
+	}
+	if (tx_stopped) return '\0'; // XON start it again
+#endif
 	if (tx_buff_in!=tx_buff_out) {
 		c=tx_buff[tx_buff_out++];
 		tx_buff_out%=TX_BUFF_SIZE;
@@ -122,6 +147,17 @@ static volatile uint8_t COM_requests;
  *  \note
  ******************************************************************************/
 void COM_rx_char_isr(char c) {
+#if COM_FLOW_XONXOFF
+	if (c==XOFF) {
+		tx_stopped=true;
+		return;
+	}
+	if (c==XON) {
+		tx_stopped=false;
+		RS_startSend();
+		return;
+	}
+#endif
 	if (c!='\0') {  // ascii based protocol, \0 char is not alloweed, ignore it
 		if (c=='\r') c='\n';  // mask diffrence between operating systems
 		rx_buff[rx_buff_in++]=c;
@@ -129,7 +165,17 @@ void COM_rx_char_isr(char c) {
 		if (rx_buff_in==rx_buff_out) { // buffer overloaded, drop oldest char 
 			rx_buff_out++;
 			rx_buff_out%=RX_BUFF_SIZE;
+			if (COM_stat.rx_overflow!=0xffff) COM_stat.rx_overflow++;
+		}
+		uint8_t used=(rx_buff_in-rx_buff_out+RX_BUFF_SIZE)%RX_BUFF_SIZE;
+		if (used>COM_stat.rx_high) COM_stat.rx_high=used;
+#if COM_FLOW_XONXOFF
+		if ((!rx_stopped) && (RX_BUFF_SIZE-used<RX_XOFF_FREE)) {
+			rx_stopped=true;
+			flow_send=XOFF;
+			RS_startSend();
 		}
+#endif
 		if (c=='\n') {
 			task |= TASK_COM;
 			COM_requests++;
@@ -150,6 +196,14 @@ static char COM_getchar(void) {
 		c=rx_buff[rx_buff_out++];
 		rx_buff_out%=RX_BUFF_SIZE;
     	if (c=='\n') COM_requests--;
+#if COM_FLOW_XONXOFF
+		if (rx_stopped
+			&& (RX_BUFF_SIZE-(uint8_t)((rx_buff_in-rx_buff_out+RX_BUFF_SIZE)%RX_BUFF_SIZE)>=RX_XON_FREE)) {
+			rx_stopped=false;
+			flow_send=XON;
+			RS_startSend();
+		}
+#endif
 	} else {
     	COM_requests=0;
         c='\0';
@@ -303,7 +357,7 @@ void COM_print_debug(int8_t valve) {
     \note dirty trick with shared array for \ref COM_hex_parse and \ref COM_commad_parse
     code size optimalization
 */
-static uint8_t com_hex[4];
+static uint8_t com_hex[3+WL_BLOCK_MAX]; // block write command is longest
 
 /*!
  *******************************************************************************
@@ -374,6 +428,15 @@ static void print_incomplete_mark(int8_t len) {
  *  \note   D\n - print status line 
  *  \note   Yyymmdd\n - set, year yy, month mm, day dd; HEX values!!!
  *  \note   HhhmmSSss\n - set, hour hh, minute mm, second SS, 1/100 second ss; HEX values!!!
+ *  \note   E\n - print buffer status "E: RX oooo hh TX oooo hhhh Q oooo hh F ffff uuuu",
+ *  \note         oooo overflow counter, hh high-water mark (cleared by this command)
+ *  \note         ffff frames corrected by FEC, uuuu uncorrectable FEC frames
+ *  \note   {gg}Cpp..\n - group command C (A M L W) for group mask gg, 00 = all,
+ *  \note         sent in sync packets without force (O0000), refused until previous one is finished
+ *  \note   Iaann\n - link quality of nn (max 8) slaves from aa, nn|0x80 clear them,
+ *  \note         line "I[aa]=oooo eeee ff rr AA mm MM h0h1h2h3" for each slave
+ *  \note         ok frames, MAC errors, FEC repaired, RSSI above threshold,
+ *  \note         AFC last/min/max, reply time histogram (LQ_HIST_STEP/100 s bins)
  *	
  ******************************************************************************/
 void COM_commad_parse (void) {
@@ -388,6 +451,32 @@ void COM_commad_parse (void) {
 			if (COM_getchar()=='\n') COM_print_debug(-1);
 			c='\0';
 			break;
+		case 'E':
+			if (COM_getchar()!='\n') { c='\0'; break; }
+			print_s_p(PSTR("E: RX "));
+			print_hexXXXX(COM_stat.rx_overflow);
+			COM_putchar(' ');
+			print_hexXX(COM_stat.rx_high);
+			print_s_p(PSTR(" TX "));
+			print_hexXXXX(COM_stat.tx_overflow);
+			COM_putchar(' ');
+			print_hexXXXX(COM_stat.tx_high);
+			print_s_p(PSTR(" Q "));
+			print_hexXXXX(COM_stat.q_overflow);
+			COM_putchar(' ');
+			print_hexXX(COM_stat.q_high);
+			#if (WL_FEC)
+			print_s_p(PSTR(" F "));
+			print_hexXXXX(wl_fec_fixed);
+			COM_putchar(' ');
+			print_hexXXXX(wl_fec_failed);
+			#endif
+			cli();
+			COM_stat.rx_high=0;
+			COM_stat.tx_high=0;
+			COM_stat.q_high=0;
+			sei();
+			break;
 		case 'Y':
 			if (COM_hex_parse(3*2,true)!='\0') { break; }
 			RTC_SetDate(com_hex[2],com_hex[1],com_hex[0]);
@@ -463,42 +552,88 @@ void COM_commad_parse (void) {
     			if (COM_hex_parse(1*2,false)!='\0') { break; }
     			uint8_t addr=com_hex[0];
     			if (COM_getchar()!='-') { break; }
+    			// bank digit is accepted for compatibility, packets are packed by Q_pack
     			if (COM_hex_parse(1,false)!='\0') { break; }
-    			uint8_t bank=com_hex[0]>>4;
     			if (COM_getchar()!=')') { break; }
     			uint8_t ch=COM_getchar();
-    			uint8_t len=0;
-    			switch (ch) {
-                    case 'D':
-                    case 'V':
-                        len=0;
-                        break;
-                    case 'M':
-                    case 'A':
-                    case 'L':
-                    case 'T':
-                    case 'G':
-                    case 'R':
-                        len=1;
-                        break;
-                    case 'S':
-                    case 'B':
-                        len=2;
-                        break;
-                    case 'W':
-                        len=3;
-                        break;
-                    default:
-                        break;
+    			uint8_t len=Q_cmd_param(ch);
+                if (len==0xff) {
+                    // block write: start count data[count] (U: count of words, O: firmware chunk)
+                    if (COM_hex_parse(2*2,false)!='\0') { break; }
+                    uint8_t start=com_hex[0];
+                    uint8_t n=com_hex[1];
+                    if (ch=='U') n*=2;
+                    if (n>WL_BLOCK_MAX) { break; }
+                    if (COM_hex_parse(n*2,true)!='\0') { break; }
+                    memmove(com_hex+3,com_hex,n);
+                    com_hex[0]=ch;
+                    com_hex[1]=start;
+                    com_hex[2]=(ch=='U')?n/2:n;
+                    // longer than one queue item
+                    if (!Q_push_data(n+3,addr,com_hex)) { break; }
+                    print_s_p(PSTR("OK"));
+                    break;
                 }
                 if (COM_hex_parse(len*2,true)!='\0') { break; }
-                uint8_t * d = Q_push(len+1, addr, bank);
-                if (d==NULL) { break; }
-                d[0]=ch;
-                memcpy(d+1,com_hex,len);
+                memmove(com_hex+1,com_hex,len);
+                com_hex[0]=ch;
+                // Z is longer than one queue item
+                if (!Q_push_data(len+1,addr,com_hex)) { break; }
                 print_s_p(PSTR("OK"));
             }
             break;            		    
+		case '{':
+		    {
+    			if (COM_hex_parse(1*2,false)!='\0') { break; }
+    			uint8_t group=com_hex[0];
+    			if (COM_getchar()!='}') { break; }
+    			uint8_t ch=COM_getchar();
+    			if ((ch!='A') && (ch!='M') && (ch!='L') && (ch!='W')) { break; }
+    			uint8_t len=Q_cmd_param(ch);
+                if (COM_hex_parse(len*2,true)!='\0') { break; }
+                memmove(com_hex+1,com_hex,len);
+                com_hex[0]=ch;
+                if (!wl_group_set(group,com_hex,len+1)) { break; }
+                print_s_p(PSTR("OK"));
+            }
+            break;
+#if (LINKQ)
+		case 'I':
+			{
+				if (COM_hex_parse(2*2,true)!='\0') { break; }
+				uint8_t addr=com_hex[0];
+				uint8_t n=com_hex[1]&0x7f;
+				if (n>8) n=8; // tx_buff space
+				while (n--) {
+					lq_item_t * p=LQ_get(addr);
+					if (p==NULL) break;
+					print_idx(c);
+					print_hexXXXX(p->ok);
+					COM_putchar(' ');
+					print_hexXXXX(p->mac_err);
+					COM_putchar(' ');
+					print_hexXX(p->fec);
+					COM_putchar(' ');
+					print_hexXX(p->rssi);
+					COM_putchar(' ');
+					print_hexXX(p->afc);
+					COM_putchar(' ');
+					print_hexXX(p->afc_min);
+					COM_putchar(' ');
+					print_hexXX(p->afc_max);
+					COM_putchar(' ');
+					{
+						uint8_t i;
+						for (i=0;i<LQ_HIST;i++) print_hexXX(p->hist[i]);
+					}
+					if (com_hex[1]&0x80) LQ_clear(addr);
+					addr++;
+					com_hex[0]=addr;
+					if (n && (addr<LQ_ADDR_MAX)) COM_putchar('\n');
+				}
+			}
+			break;
+#endif
 		case 'B':
 			{
 				if (COM_hex_parse(2*2,true)!='\0') { break; }
@@ -649,6 +784,7 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok) {
                 break;                
             case 'G':
             case 'S':
+            case 'O':
                 COM_putchar(d[0]);
                 len-=3;
                 if (len<0) {
@@ -662,7 +798,54 @@ void COM_dump_packet(uint8_t *d, int8_t len, bool mac_ok) {
                 print_hexXX(d[2]);
                 d+=3;
                 break;                
+            case 'C':
+                // config size, 9 CRC16 digests (config, timers day 0-7)
+                COM_putchar(d[0]);
+                len-=2+9*2;
+                if (len<0) {
+                    print_incomplete_mark(len);
+                    break;
+                }
+                COM_putchar('[');
+                print_hexXX(d[1]);
+                COM_putchar(']');
+                COM_putchar('=');
+                {
+                    uint8_t i;
+                    for (i=2;i<2+9*2;i++) {
+                        print_hexXX(d[i]);
+                    }
+                }
+                d+=2+9*2;
+                break;
+            case 'X':
+            case 'Y':
+            case 'Q':
+            case 'U':
+            case 'K':
+                COM_putchar(d[0]);
+                {
+                    // start count data[count], timers have words, K motor records
+                    uint8_t n = d[2];
+                    if ((d[0]=='Q') || (d[0]=='U')) n*=2;
+                    if (d[0]=='K') n*=WL_MOTOR_LOG_RECORD;
+                    len-=3+n;
+                    if (len<0) {
+                        print_incomplete_mark(len);
+                        break;
+                    }
+                    COM_putchar('[');
+                    print_hexXX(d[1]);
+                    COM_putchar(']');
+                    COM_putchar('=');
+                    d+=3;
+                    while (n--) {
+                        print_hexXX(*(d++));
+                    }
+                }
+                break;
             case 'L':
+            case 'Z':
                 COM_putchar(d[0]);
                 len-=2;
                 if (len<0) {
@@ -33,6 +33,17 @@
 
 #pragma once
 
+typedef struct {
+    uint16_t rx_overflow; // chars dropped, rx_buff full
+    uint16_t tx_overflow; // chars dropped, tx_buff full
+    uint16_t q_overflow;  // commands refused, queue full
+    uint8_t rx_high;      // high-water marks, cleared by E command
+    uint16_t tx_high;
+    uint8_t q_high;       // queue items
+} com_stat_t;
+
+extern com_stat_t COM_stat;
+
 char COM_tx_char_isr(void);
 
 void COM_rx_char_isr(char c);
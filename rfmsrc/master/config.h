@@ -76,6 +76,9 @@ In this file we define only configuration parameters, for example what kind of c
 /* #define COM_RS485  */
 /* Our default Adress, if not set or invalid */
 /* #define COM_DEF_ADR 1 */
+/* XON/XOFF flow control, host must stop sending on XOFF (stty ixon),
+   frontend/tools/daemon.php set it, other hosts must be configured */
+#define COM_FLOW_XONXOFF 1
 
 #if (NANODE == 1)
  #define LED_RX_on() (PORTD |= _BV(PD5))
@@ -125,6 +128,9 @@ In this file we define only configuration parameters, for example what kind of c
     #ifndef SECURITY_KEY_7
 	#define SECURITY_KEY_7		0xef
     #endif
+	#define WL_GROUP_CMD 1 //!< group/broadcast commands in sync packet
+	#define WL_FEC 1 //!< FEC frames, used in reply if request has it
+	#define LINKQ 1 //!< link quality table of slaves, COM command I
 #else
 	#define RFM12                  0
 	#define DISABLE_JTAG           0
@@ -0,0 +1,120 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Dario Carluccio (hr20-at-carluccio-dot-de)
+ *				2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       linkq.c
+ * \brief      link quality table of slaves
+ * \author     Jiri Dobry <jdobry-at-centrum-dot-cz>
+ * \date       $Date$
+ * $Rev$
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+// HR20 Project includes
+#include "config.h"
+#include "main.h"
+#include "linkq.h"
+#include "../common/rtc.h"
+
+#if (LINKQ)
+static lq_item_t LQ_tab[LQ_ADDR_MAX];
+static uint8_t LQ_reply_addr=0xff; //!< slave waiting for reply
+static uint8_t LQ_reply_s100;      //!< RTC_s100 of request
+
+/*!
+ *******************************************************************************
+ *  \brief saturated increment
+ ******************************************************************************/
+static void LQ_inc8(uint8_t *c) {
+    if (*c!=0xff) (*c)++;
+}
+
+static void LQ_inc16(uint16_t *c) {
+    if (*c!=0xffff) (*c)++;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief account received data frame
+ *
+ *  \note afc and rfm_quality are read by RFM interrupt on begin of frame
+ ******************************************************************************/
+void LQ_rx(uint8_t addr, bool mac_ok, bool fec_fixed) {
+    lq_item_t * p;
+    int8_t a;
+    LQ_reply_addr=0xff;
+    if ((addr==0) || (addr>=LQ_ADDR_MAX)) return;
+    p=LQ_tab+addr;
+    if (!mac_ok) {
+        LQ_inc16(&p->mac_err);
+        return;
+    }
+    LQ_inc16(&p->ok);
+    if (fec_fixed) LQ_inc8(&p->fec);
+    if (rfm_quality & RFM_QUALITY_RSSI) LQ_inc8(&p->rssi);
+    a=(afc & 0x10)?(int8_t)(afc|0xe0):(int8_t)afc; // 5 bit 2's complement
+    p->afc=a;
+    if ((p->ok==1) || (a<p->afc_min)) p->afc_min=a;
+    if ((p->ok==1) || (a>p->afc_max)) p->afc_max=a;
+    LQ_reply_addr=addr;
+    LQ_reply_s100=RTC_s100;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief reply is sent, account reply time
+ ******************************************************************************/
+void LQ_tx_done(void) {
+    uint8_t t;
+    if (LQ_reply_addr>=LQ_ADDR_MAX) return;
+    t=(uint8_t)(RTC_s100+100-LQ_reply_s100)%100;
+    t/=LQ_HIST_STEP;
+    if (t>=LQ_HIST) t=LQ_HIST-1;
+    LQ_inc8(&LQ_tab[LQ_reply_addr].hist[t]);
+    LQ_reply_addr=0xff;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief table item of slave
+ *
+ *  \returns NULL for invalid address
+ ******************************************************************************/
+lq_item_t * LQ_get(uint8_t addr) {
+    if (addr>=LQ_ADDR_MAX) return NULL;
+    return LQ_tab+addr;
+}
+
+/*!
+ *******************************************************************************
+ *  \brief clear table item of slave
+ ******************************************************************************/
+void LQ_clear(uint8_t addr) {
+    if (addr<LQ_ADDR_MAX) memset(LQ_tab+addr,0,sizeof(lq_item_t));
+}
+#endif
@@ -0,0 +1,55 @@
+/*
+ *  Open HR20 - RFM12 master
+ *
+ *  target:     ATmega32 @ 10 MHz in Honnywell Rondostat HR20E master
+ *
+ *  compiler:    WinAVR-20071221
+ *              avr-libc 1.6.0
+ *              GCC 4.2.2
+ *
+ *  copyright:  2008 Dario Carluccio (hr20-at-carluccio-dot-de)
+ *				2008 Jiri Dobry (jdobry-at-centrum-dot-cz)
+ *
+ *  license:    This program is free software; you can redistribute it and/or
+ *              modify it under the terms of the GNU Library General Public
+ *              License as published by the Free Software Foundation; either
+ *              version 2 of the License, or (at your option) any later version.
+ *
+ *              This program is distributed in the hope that it will be useful,
+ *              but WITHOUT ANY WARRANTY; without even the implied warranty of
+ *              MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+ *              GNU General Public License for more details.
+ *
+ *              You should have received a copy of the GNU General Public License
+ *              along with this program. If not, see http:*www.gnu.org/licenses
+ */
+
+/*!
+ * \file       linkq.h
+ * \brief      link quality table of slaves
+ * \author     Jiri Dobry <jdobry-at-centrum-dot-cz>
+ * \date       $Date$
+ * $Rev$
+ */
+
+#pragma once
+
+#define LQ_ADDR_MAX 30   // slave addresses 1..29
+#define LQ_HIST 4        // reply time histogram bins
+#define LQ_HIST_STEP 4   // bin width [1/100 s]
+
+typedef struct {
+    uint16_t ok;         // valid frames
+    uint16_t mac_err;    // frames with wrong MAC, address is taken from frame
+    uint8_t fec;         // valid frames repaired by FEC
+    uint8_t rssi;        // valid frames with RSSI above threshold
+    int8_t afc;          // AFC offset of last valid frame
+    int8_t afc_min;
+    int8_t afc_max;
+    uint8_t hist[LQ_HIST]; // time from request to end of reply
+} lq_item_t;
+
+void LQ_rx(uint8_t addr, bool mac_ok, bool fec_fixed);
+void LQ_tx_done(void);
+lq_item_t * LQ_get(uint8_t addr);
+void LQ_clear(uint8_t addr);
@@ -55,6 +55,7 @@
 
 #if (RFM == 1)
     volatile uint8_t afc = 0;
+    volatile uint8_t rfm_quality = 0;
 	#include "rfm_config.h"
 	#include "../common/rfm.h"
 #endif
@@ -151,7 +152,6 @@ int __attribute__ ((noreturn)) main(void)
         if (task & TASK_RTC) {
             task&=~TASK_RTC;
             {
-                wl_packet_bank=0;
                 RTC_AddOneSecond();
                 bool minute=(RTC_GetSecond()==0);
                 if (RTC_GetSecond()<30) {
@@ -176,7 +176,15 @@ int __attribute__ ((noreturn)) main(void)
                     wireless_putchar((RTC_GetMonth()<<4) + (d>>3)); 
                     wireless_putchar((d<<5) + RTC_GetHour());
                     wireless_putchar((RTC_GetMinute()<<1) + ((RTC_GetSecond()==30)?1:0));
-                    if (wl_force_addr1!=0xfe) {
+                    bool group_sent=false;
+                    #if (WL_GROUP_CMD)
+                    // group command only in sync without force, slaves
+                    // without WL_GROUP_CMD must not miss forced communication
+                    if ((wl_force_addr1==0xfe) || ((wl_force_addr1|wl_force_addr2)==0)) {
+                        group_sent=wl_group_put();
+                    }
+                    #endif
+                    if ((!group_sent) && (wl_force_addr1!=0xfe)) {
                         if (wl_force_addr1==0xff) {
                             wireless_putchar(((uint8_t*)&wl_force_flags)[0]);
                             wireless_putchar(((uint8_t*)&wl_force_flags)[1]);
@@ -320,9 +328,11 @@ ISR (INT2_vect){
     	}
     } else if (rfm_mode == rfmmode_rx) {
         rfm_framebuf[rfm_framepos++]=RFM_READ_FIFO();
-#if (RFM_TUNING>0)
+#if (RFM_TUNING>0) || (LINKQ)
 		if (rfm_framepos == 6) { // get AFC value
-		  afc = RFM_READ_STATUS() & 0x1f;
+		  uint16_t st = RFM_READ_STATUS();
+		  afc = st & 0x1f;
+		  rfm_quality = (st>>7) & (RFM_QUALITY_DQD|RFM_QUALITY_RSSI);
 		}
 #endif
         if (rfm_framepos >= RFM_FRAME_MAX) rfm_mode = rfmmode_rx_owf;
@@ -1,3 +1,8 @@
 
 // record frequency drift between an rx/tx pair AFC circuit
 volatile uint8_t afc;
+
+// RFM status flags of last received frame
+#define RFM_QUALITY_DQD 0x01  // data quality detector
+#define RFM_QUALITY_RSSI 0x02 // RSSI above threshold
+extern volatile uint8_t rfm_quality;
@@ -34,25 +34,87 @@
  
 #include <stdint.h>
 #include <string.h>
+#include <avr/pgmspace.h>
 
 // HR20 Project includes
 #include "config.h"
 #include "queue.h"
+#include "com.h"
+#include "../common/wireless.h"
 
 static q_item_t Q_buf[Q_ITEMS];
 
+/*
+ * commands known by slave, see COM_wireless_command_parse in OpenHR20/com.c
+ *   param - request bytes behind command char, 0xff for block write
+ *   reply - reply bytes including command char
+ *   block - bytes per count unit of block command (request data[2]),
+ *           added to reply (and to request for block write), count is
+ *           limited to WL_BLOCK_MAX/block by slave
+ * last item is used for unknown commands
+ */
+static const q_cmd_t Q_cmds[] PROGMEM = {
+    { 'A', 1, 10, Q_PRIO_USER, 0 },
+    { 'M', 1, 10, Q_PRIO_USER, 0 },
+    { 'L', 1, 2, Q_PRIO_USER, 0 },
+    { 'S', 2, 3, Q_PRIO_WRITE, 0 },
+    { 'W', 3, 4, Q_PRIO_WRITE, 0 },
+    { 'Y', 0xff, 3, Q_PRIO_WRITE, 1 },
+    { 'U', 0xff, 3, Q_PRIO_WRITE, 2 },
+    { 'D', 0, 10, Q_PRIO_STATUS, 0 },
+    { 'T', 1, 4, Q_PRIO_STATUS, 0 },
+    { 'C', 0, 20, Q_PRIO_STATUS, 0 },
+    { 'V', 0, 48, Q_PRIO_STATUS, 0 }, // 'V' + VERSION_STRING + '\n'
+    { 'G', 1, 3, Q_PRIO_BULK, 0 },
+    { 'R', 1, 4, Q_PRIO_BULK, 0 },
+    { 'X', 2, 3, Q_PRIO_BULK, 1 },
+    { 'Q', 2, 3, Q_PRIO_BULK, 2 },
+    { 'K', 2, 3, Q_PRIO_BULK, WL_MOTOR_LOG_RECORD }, // motor run records
+    { 'O', 0xff, 3, Q_PRIO_LAST, 0 }, // firmware delta chunk
+    { 'Z', 6, 2, Q_PRIO_LAST, 0 },    // firmware delta begin/commit, commit reboot
+    { 'B', 2, 1, Q_PRIO_LAST, 0 }, // reboot, nothing after it is processed
+    { 0, 0, 1, Q_PRIO_LAST, 0 }
+};
+
+/*!
+ *******************************************************************************
+ *  \brief find command in Q_cmds
+ *
+ *  \returns pointer to program memory, last item for unknown command
+ ******************************************************************************/
+static const q_cmd_t * Q_cmd_find(uint8_t ch) {
+    const q_cmd_t * c = Q_cmds;
+    while (1) {
+        uint8_t cmd = pgm_read_byte(&c->cmd);
+        if ((cmd==ch) || (cmd==0)) return c;
+        c++;
+    }
+}
+
+/*!
+ *******************************************************************************
+ *  \brief request parameters length of command
+ *
+ *  \returns bytes behind command char, 0xff for variable length (block write)
+ ******************************************************************************/
+uint8_t Q_cmd_param(uint8_t ch) {
+    return pgm_read_byte(&Q_cmd_find(ch)->param);
+}
+
 /*!
  *******************************************************************************
  *  \brief push one item si queue
  *
  *  \note
  ******************************************************************************/
-uint8_t* Q_push(uint8_t len, uint8_t addr, uint8_t bank) {
+uint8_t* Q_push(uint8_t len, uint8_t addr) {
     uint8_t i;
     uint8_t free=0xff;
+    uint8_t used=1;
     
     for (i=0;i<Q_ITEMS;i++) {
-        if ((Q_buf[i].addr == addr) && (Q_buf[i].bank == bank)) {
+        if (Q_buf[i].addr != 0) used++;
+        if (Q_buf[i].addr == addr) {
             free=0xff;
         } else { 
             if ((free==0xff)&&(Q_buf[i].addr == 0)) {
@@ -61,12 +123,47 @@ uint8_t* Q_push(uint8_t len, uint8_t addr, uint8_t bank) {
         }
     }
     if (free==0xff) return NULL;
+    if (used>COM_stat.q_high) COM_stat.q_high=used;
     Q_buf[free].len=len;
     Q_buf[free].addr=addr;
-    Q_buf[free].bank=bank;
     return Q_buf[free].data;
 }
 
+/*!
+ *******************************************************************************
+ *  \brief push command longer than one item
+ *
+ *  \note data are split to consecutive items with same addr, all items
+ *        except first one have Q_CONT flag and Q_pack sends them together
+ *  \returns false if there is no space for all parts (nothing is pushed)
+ ******************************************************************************/
+bool Q_push_data(uint8_t len, uint8_t addr, uint8_t *data) {
+    uint8_t i;
+    uint8_t free=0;
+    uint8_t cont=0;
+
+    // Q_push use only free items behind last item of addr
+    for (i=0;i<Q_ITEMS;i++) {
+        if (Q_buf[i].addr == addr) {
+            free=0;
+        } else if (Q_buf[i].addr == 0) {
+            free++;
+        }
+    }
+    if ((uint16_t)free*sizeof(Q_buf[0].data) < len) {
+        if (COM_stat.q_overflow!=0xffff) COM_stat.q_overflow++;
+        return false;
+    }
+    while (len>0) {
+        uint8_t l = (len>sizeof(Q_buf[0].data))?sizeof(Q_buf[0].data):len;
+        memcpy(Q_push(l|cont, addr), data, l);
+        cont=Q_CONT;
+        data+=l;
+        len-=l;
+    }
+    return true;
+}
+
 /*!
  *******************************************************************************
  *  \brief clean buffer for addr
@@ -83,16 +180,53 @@ void Q_clean(uint8_t addr_preserve) {
 
 /*!
  *******************************************************************************
- *  \brief get items for addr_bank
+ *  \brief send queued commands for addr, one packet
  *
- *  \note
+ *  \note commands are taken by priority (user actions first, bulk refresh
+ *        last) and in queue order inside one priority. Command which does
+ *        not fit is skipped and smaller one behind it can fill the rest,
+ *        except last priority, firmware update must keep its order.
+ *        Slave use one buffer for request and reply, both are counted
+ *        to size. Sent items are removed from queue.
  ******************************************************************************/
-q_item_t * Q_get(uint8_t addr, uint8_t bank, uint8_t skip) {
-    uint8_t i;
-    for (i=0;i<Q_ITEMS;i++) {
-        if ((Q_buf[i].addr == addr) && (Q_buf[i].bank == bank)) {
-            if ((skip--)==0) return Q_buf+i;
+void Q_pack(uint8_t addr, uint8_t size) {
+    uint8_t prio;
+    for (prio=0;prio<Q_PRIO_COUNT;prio++) {
+        uint8_t i;
+        for (i=0;i<Q_ITEMS;i++) {
+            q_item_t * p = Q_buf+i;
+            if ((p->addr != addr) || (p->len & Q_CONT)) continue;
+            const q_cmd_t * c = Q_cmd_find(p->data[0]);
+            if (pgm_read_byte(&c->prio) != prio) continue;
+            uint8_t j;
+            uint8_t req=p->len;
+            for (j=i+1;j<Q_ITEMS;j++) {
+                if (Q_buf[j].addr != addr) continue;
+                if ((Q_buf[j].len & Q_CONT) == 0) break;
+                req+=Q_buf[j].len & ~Q_CONT;
+            }
+            uint16_t reply = pgm_read_byte(&c->reply);
+            uint8_t block = pgm_read_byte(&c->block);
+            if (block) {
+                // slave limits count to WL_BLOCK_MAX bytes, same here
+                uint8_t n = (p->len>2)?p->data[2]:0;
+                if (n>WL_BLOCK_MAX/block) n=WL_BLOCK_MAX/block;
+                reply += n*block;
+            }
+            if (req+reply > size) {
+                if (prio==Q_PRIO_LAST) return;
+                continue;
+            }
+            size -= req+reply;
+            for (j=i;j<Q_ITEMS;j++) {
+                if (Q_buf[j].addr != addr) continue;
+                if ((j!=i) && ((Q_buf[j].len & Q_CONT) == 0)) break;
+                uint8_t k;
+                for (k=0;k<(Q_buf[j].len & ~Q_CONT);k++) {
+                    wireless_putchar(Q_buf[j].data[k]);
+                }
+                Q_buf[j].addr=0;
+            }
         }
     }
-    return NULL;
 }
@@ -35,17 +35,35 @@
 
 #define Q_ITEMS 50
 
+#define Q_CONT 0x80 // len flag: continuation of previous item (Q_push_data)
+
 typedef struct {
     uint8_t len;
     uint8_t addr;
-    uint8_t bank;
     uint8_t data[4];
 } q_item_t;  
 
 // extern q_item_t Q_buf[Q_ITEMS];
 
+// command priority for Q_pack, lower is sent first
+#define Q_PRIO_USER 0   // user actions A M L
+#define Q_PRIO_WRITE 1  // S W Y U
+#define Q_PRIO_STATUS 2 // D T C V
+#define Q_PRIO_BULK 3   // G R X Q refresh
+#define Q_PRIO_LAST 4   // B O Z and unknown
+#define Q_PRIO_COUNT 5
 
-uint8_t* Q_push(uint8_t len, uint8_t addr, uint8_t bank);
-void Q_clean(uint8_t addr_preserve);
-q_item_t* Q_get(uint8_t addr, uint8_t bank, uint8_t skip);
+typedef struct {
+    uint8_t cmd;
+    uint8_t param;
+    uint8_t reply;
+    uint8_t prio;
+    uint8_t block;
+} q_cmd_t;
 
+
+uint8_t* Q_push(uint8_t len, uint8_t addr);
+bool Q_push_data(uint8_t len, uint8_t addr, uint8_t *data);
+void Q_clean(uint8_t addr_preserve);
+uint8_t Q_cmd_param(uint8_t ch);
+void Q_pack(uint8_t addr, uint8_t size);
@@ -0,0 +1,407 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	flash.c
+ * \brief	firmware update over the serial bootloader
+ *
+ * The bootloader speaks XModem-CRC. Extensions understood by the
+ * bootloader in trunk/source/bootloader, all sent before the first block:
+ *
+ *  'B'  answer 'B' and switch to BAUDRATE_FAST
+ *  'K'  answer 'K', page count and CRC16 (high byte first) of every page
+ *  <stx> 1024 byte blocks (XModem-1K)
+ *  missing block numbers skip Flash in units of 128 bytes (one page),
+ *  this is used to leave unchanged pages untouched
+ *
+ * An old bootloader ignores 'B' and 'K', the whole image is sent in
+ * sequential 128 byte blocks then.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/time.h>
+
+#include "serial.h"
+#include "flash.h"
+
+#define XMODEM_SOH 0x01
+#define XMODEM_STX 0x02
+#define XMODEM_EOT 0x04
+#define XMODEM_ACK 0x06
+#define XMODEM_NAK 0x15
+#define XMODEM_RWC 'C'
+#define XMODEM_BAUD 'B'
+#define XMODEM_PAGECRC 'K'
+
+#define XMODEM_RETRY 5
+#define FLASH_1K_PAGES (1024 / FLASH_PAGE_SIZE)
+
+static uint8_t image[FLASH_APP_SIZE];
+static uint16_t device_crc[FLASH_APP_SIZE / FLASH_PAGE_SIZE];
+static uint8_t dirty[FLASH_APP_SIZE / FLASH_PAGE_SIZE];
+
+static int hexByte(const char *s)
+{
+	int v;
+
+	if(sscanf(s, "%2x", &v) != 1)
+		return -1;
+	return v;
+}
+
+/*!
+ ********************************************************************************
+ * readHex
+ *
+ * load intel hex file, unused bytes are 0xff
+ *
+ * \param *file file name
+ * \returns image size rounded up to whole pages, -1 on error
+ *******************************************************************************/
+static int readHex(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	char line[600];
+	uint32_t base = 0;
+	uint32_t end = 0;
+
+	if(!f)
+	{
+		printf("Could not open %s\n", file);
+		return -1;
+	}
+	memset(image, 0xff, sizeof(image));
+	while(fgets(line, sizeof(line), f))
+	{
+		int len, type, i;
+		uint32_t addr;
+		uint8_t sum;
+
+		if(line[0] != ':')
+			continue;
+		len = hexByte(line + 1);
+		addr = (hexByte(line + 3) << 8) | hexByte(line + 5);
+		type = hexByte(line + 7);
+		if(len < 0 || type < 0 || strlen(line) < (size_t)(11 + 2 * len))
+			goto error;
+		sum = len + (addr >> 8) + addr + type + hexByte(line + 9 + 2 * len);
+		for(i = 0; i < len; i++)
+			sum += hexByte(line + 9 + 2 * i);
+		if(sum != 0)
+			goto error;
+
+		if(type == 0)
+		{
+			addr += base;
+			if(addr + len > FLASH_APP_SIZE)
+			{
+				printf("Image overlaps bootloader at 0x%04x\n", FLASH_APP_SIZE);
+				fclose(f);
+				return -1;
+			}
+			for(i = 0; i < len; i++)
+				image[addr + i] = hexByte(line + 9 + 2 * i);
+			if(addr + len > end)
+				end = addr + len;
+		}
+		else if(type == 1)
+			break;
+		else if(type == 2)
+			base = ((hexByte(line + 9) << 8) | hexByte(line + 11)) << 4;
+		else if(type == 4)
+			base = ((hexByte(line + 9) << 8) | hexByte(line + 11)) << 16;
+	}
+	fclose(f);
+	return (end + FLASH_PAGE_SIZE - 1) / FLASH_PAGE_SIZE * FLASH_PAGE_SIZE;
+
+error:
+	printf("Bad record in %s: %s", file, line);
+	fclose(f);
+	return -1;
+}
+
+static uint16_t crc16(const uint8_t *data, int len)
+{
+	uint16_t crc = 0;
+	int i;
+
+	while(len--)
+	{
+		crc ^= (uint16_t)*data++ << 8;
+		for(i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+static double now(void)
+{
+	struct timeval tv;
+
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + tv.tv_usec / 1e6;
+}
+
+static speed_t speedConst(int baudrate)
+{
+	switch(baudrate)
+	{
+		case 9600:	return B9600;
+		case 19200:	return B19200;
+		case 38400:	return B38400;
+		case 57600:	return B57600;
+		case 115200:	return B115200;
+		default:	return 0;
+	}
+}
+
+/*!
+ ********************************************************************************
+ * bootWait
+ *
+ * wait for one of two characters, everything else (mostly 'C') is skipped
+ *
+ * \returns the character or -1 on timeout
+ *******************************************************************************/
+static int bootWait(uint8_t a, uint8_t b, int timeout_ms)
+{
+	uint8_t c;
+
+	while(serialRead(&c, 1, timeout_ms) == 1)
+	{
+		if(c == a || c == b)
+			return c;
+	}
+	return -1;
+}
+
+/*!
+ ********************************************************************************
+ * bootConnect
+ *
+ * reboot running firmware (B1324) and enter the bootloader
+ *
+ * \returns 1 when bootloader waits for data
+ *******************************************************************************/
+static int bootConnect(void)
+{
+	const uint8_t key = FLASH_BOOT_KEY;
+	int i;
+
+	serialRaw(B9600);
+	serialWrite("\rB1324\r", 7);
+	usleep(50000);
+	serialFlush();
+	/* bootloader checks password every 200ms, one key per check period */
+	for(i = 0; i < 20; i++)
+	{
+		serialWrite(&key, 1);
+		if(bootWait(XMODEM_RWC, XMODEM_RWC, 300) == XMODEM_RWC)
+			return 1;
+	}
+	return 0;
+}
+
+/*!
+ ********************************************************************************
+ * bootBaud
+ *
+ * ask bootloader for fast baudrate
+ *
+ * \returns 1 when fast baudrate is used, 0 when bootloader stays on 9600,
+ *  -1 when bootloader switched but does not answer
+ *******************************************************************************/
+static int bootBaud(speed_t speed)
+{
+	const uint8_t cmd = XMODEM_BAUD;
+
+	serialWrite(&cmd, 1);
+	if(bootWait(XMODEM_BAUD, XMODEM_BAUD, 500) != XMODEM_BAUD)
+		return 0;
+	serialRaw(speed);
+	serialFlush();
+	return (bootWait(XMODEM_RWC, XMODEM_RWC, 1000) == XMODEM_RWC) ? 1 : -1;
+}
+
+/*!
+ ********************************************************************************
+ * bootPageCrc
+ *
+ * read CRC of all application pages from bootloader
+ *
+ * \returns number of pages, 0 if bootloader does not support it
+ *******************************************************************************/
+static int bootPageCrc(void)
+{
+	const uint8_t cmd = XMODEM_PAGECRC;
+	uint8_t buf[2 * FLASH_APP_SIZE / FLASH_PAGE_SIZE];
+	uint8_t n;
+	int i;
+
+	serialWrite(&cmd, 1);
+	if(bootWait(XMODEM_PAGECRC, XMODEM_PAGECRC, 500) != XMODEM_PAGECRC)
+		return 0;
+	if(serialRead(&n, 1, 500) != 1 || n > FLASH_APP_SIZE / FLASH_PAGE_SIZE)
+		return 0;
+	if(serialRead(buf, 2 * n, 1000) != 2 * n)
+		return 0;
+	for(i = 0; i < n; i++)
+		device_crc[i] = (buf[2 * i] << 8) | buf[2 * i + 1];
+	return n;
+}
+
+/*!
+ ********************************************************************************
+ * xmodemBlock
+ *
+ * send one block and wait for ACK, resend on NAK or timeout
+ *
+ * \returns 1 on success
+ *******************************************************************************/
+static int xmodemBlock(uint8_t nr, const uint8_t *data, int size)
+{
+	uint8_t hdr[3];
+	uint8_t crc[2];
+	uint16_t c = crc16(data, size);
+	int retry;
+
+	hdr[0] = (size == 1024) ? XMODEM_STX : XMODEM_SOH;
+	hdr[1] = nr;
+	hdr[2] = ~nr;
+	crc[0] = c >> 8;
+	crc[1] = c;
+	for(retry = 0; retry < XMODEM_RETRY; retry++)
+	{
+		serialWrite(hdr, 3);
+		serialWrite(data, size);
+		serialWrite(crc, 2);
+		if(bootWait(XMODEM_ACK, XMODEM_NAK, 3000) == XMODEM_ACK)
+			return 1;
+	}
+	return 0;
+}
+
+/*!
+ ********************************************************************************
+ * hr20Flash
+ *
+ * write firmware image through the bootloader
+ *
+ * \param *hexfile intel hex file
+ * \param baudrate wanted transfer baudrate, bootloader starts on 9600
+ * \param force write all pages, do not compare CRCs
+ * \returns 1 on success, 0 on failure
+ *******************************************************************************/
+int hr20Flash(const char *hexfile, int baudrate, int force)
+{
+	int size, pages, p, changed;
+	int ext = 0;
+	int addr = 0;
+	uint8_t nr = 0;
+	long bytes = 0;
+	double start;
+	speed_t speed = speedConst(baudrate);
+
+	if(!speed)
+	{
+		printf("Unsupported baudrate %d\n", baudrate);
+		return 0;
+	}
+	size = readHex(hexfile);
+	if(size < 0)
+		return 0;
+	pages = size / FLASH_PAGE_SIZE;
+
+	if(!bootConnect())
+	{
+		printf("No answer from bootloader\n");
+		return 0;
+	}
+	start = now();
+	if(baudrate != 9600)
+	{
+		int res = bootBaud(speed);
+		if(res < 0)
+		{
+			printf("No answer from bootloader on %d baud\n", baudrate);
+			return 0;
+		}
+		if(res == 0)
+			printf("Bootloader does not support %d baud, using 9600\n", baudrate);
+	}
+
+	if(bootPageCrc() * FLASH_PAGE_SIZE == FLASH_APP_SIZE)
+		ext = 1;
+	else
+		printf("Bootloader does not report page CRC, writing all pages\n");
+
+	changed = 0;
+	for(p = 0; p < pages; p++)
+	{
+		dirty[p] = !ext || force || device_crc[p] != crc16(image + p * FLASH_PAGE_SIZE, FLASH_PAGE_SIZE);
+		changed += dirty[p];
+	}
+	printf("Image %d pages, %d changed\n", pages, changed);
+
+	serialFlush();
+	for(p = 0; p < pages && changed > 0; )
+	{
+		int bsize = FLASH_PAGE_SIZE;
+		int skip, i;
+
+		if(!dirty[p])
+		{
+			p++;
+			continue;
+		}
+		/* 1K block when next 8 pages are changed */
+		if(ext && p + FLASH_1K_PAGES <= pages)
+		{
+			bsize = 1024;
+			for(i = 1; i < FLASH_1K_PAGES; i++)
+			{
+				if(!dirty[p + i])
+					bsize = FLASH_PAGE_SIZE;
+			}
+		}
+		skip = (p * FLASH_PAGE_SIZE - addr) / FLASH_PAGE_SIZE;
+		nr += 1 + skip;
+		if(!xmodemBlock(nr, image + p * FLASH_PAGE_SIZE, bsize))
+		{
+			printf("\nTransfer failed at 0x%04x\n", p * FLASH_PAGE_SIZE);
+			return 0;
+		}
+		bytes += bsize + 5;
+		addr = p * FLASH_PAGE_SIZE + bsize;
+		p += bsize / FLASH_PAGE_SIZE;
+		printf("\r0x%04x %5.0f bytes/s", addr, bytes / (now() - start));
+		fflush(stdout);
+	}
+
+	{
+		const uint8_t eot = XMODEM_EOT;
+		serialWrite(&eot, 1);
+		if(bootWait(XMODEM_ACK, XMODEM_ACK, 1000) != XMODEM_ACK)
+			printf("\nNo ACK for EOT\n");
+	}
+	printf("\n%ld bytes in %.1f s, %.0f bytes/s\n", bytes, now() - start,
+			bytes / (now() - start));
+	return 1;
+}
@@ -0,0 +1,34 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	flash.h
+ * \brief	firmware update over the serial bootloader (trunk/source/bootloader)
+ */
+
+#ifndef __FLASH_H__
+#define __FLASH_H__
+
+#include "../../rfmsrc/common/flash_layout.h"
+
+#define FLASH_PAGE_SIZE 128		/* SPM_PAGESIZE of ATmega169 */
+#define FLASH_APP_SIZE BOOT_START	/* BootStart in bootcfg.h */
+#define FLASH_BOOT_KEY 'd'		/* KEY in bootcfg.h */
+
+extern int hr20Flash(const char *hexfile, int baudrate, int force);
+
+#endif
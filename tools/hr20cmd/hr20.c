@@ -161,6 +161,43 @@ void hr20GetAllTimers()
 	}
 }
 
+/*!
+ ********************************************************************************
+ * hr20GetMotorLog
+ *
+ * print motor run records (command K), newest first
+ *******************************************************************************/
+void hr20GetMotorLog()
+{
+	static const char *reasons[] = {"reached", "stall", "timeout", "abort"};
+	char buffer[20];
+	char response[255];
+	unsigned int start, stop, pulses, time, avg, peak, pwm, overshoot, reason;
+	int idx;
+
+	printf("Run  Start  Stop Pulses  Time[s]  Avg  Peak PWM Over Reason\n");
+	for(idx = 0; idx < 256; idx++)
+	{
+		char *data;
+
+		sprintf(buffer,"\rK%02x\r",idx);
+		while(1)
+		{
+			serialCommand(buffer, response);
+			if(response[0] == 'K')
+				break;
+			usleep(1000);
+		}
+		data = strchr(response,'=');
+		if(!data || sscanf(data + 1,"%4x %4x %4x %4x %4x %4x %2x %2x %2x",
+			&start, &stop, &pulses, &time, &avg, &peak, &pwm, &overshoot, &reason) != 9)
+			break;
+		printf("%3d %6d %5d %6u %8.2f %4u %5u %3u %4u %s\n", idx,
+			(int16_t)start, (int16_t)stop, pulses, time * 256.0 / 15625.0, avg, peak,
+			pwm, overshoot, (reason < 4) ? reasons[reason] : "?");
+	}
+}
+
 
 /*!
  ********************************************************************************
@@ -32,6 +32,7 @@ extern void hr20ParseStatusLine(char *line);
 extern void hr20SetModeManu(void);
 extern void hr20SetModeAuto(void);
 extern void hr20GetAllTimers(void);
+extern void hr20GetMotorLog(void);
 extern void hr20UnsetTimer(int day, int slot);
 extern void hr20SetTimer(char *timer_string);
 
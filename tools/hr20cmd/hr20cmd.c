@@ -36,6 +36,7 @@
 
 #include "serial.h"
 #include "hr20.h"
+#include "flash.h"
 
 #define HR20CMD_VERSION "0.2"
 
@@ -44,6 +45,8 @@
 #define FLAG_MODE 4
 #define FLAG_TIMERS 8
 #define FLAG_SET_TIMER 16
+#define FLAG_FLASH 32
+#define FLAG_MOTOR_LOG 64
 
 static int flags;
 
@@ -56,7 +59,11 @@ static struct option long_options[] =
 	{"set_temperature", required_argument, 0, 't'},
 	{"set_mode", required_argument, 0, 'm'},
 	{"get_timers", no_argument, 0, 'g'},
+	{"motor_log", no_argument, 0, 'k'},
 	{"set_timer", required_argument, 0, 'a'},
+	{"flash", required_argument, 0, 'f'},
+	{"baudrate", required_argument, 0, 'b'},
+	{"force", no_argument, 0, 'F'},
 	{"help", no_argument, 0, 'h'},
 	{0,0,0,0}
 };
@@ -71,11 +78,16 @@ static void printUsage(void)
 	printf(" -t, --set_temperature t   set wanted temperature (19.5°C = 195)\n");
 	printf(" -m, --set_mode mode       set mode auto/manu\n");
 	printf(" -g, --get_timers          get the whole timing table\n");
+	printf(" -k, --motor_log           get records of last motor runs\n");
 	printf(" -a, --set_timer AB[CDDEE] set a specific timer\n");
 	printf("                           A day 0-7, B slot, C mode, DDEE time in hours and minutes\n");
 	printf("                           Modes: 0 frost protection, 1 energy save, 2 comfort, 3 supercomfort\n");
 	printf("                           if only day and slot specified, the slot will be unset\n");
 	printf("                           example: 1020700 stands for comfort mode on monday 7:00\n");
+	printf(" -f, --flash file.hex      write firmware through the bootloader (XModem)\n");
+	printf("                           only pages with different CRC are written\n");
+	printf(" -b, --baudrate rate       transfer baudrate for --flash (default 38400)\n");
+	printf(" -F, --force               write all pages with --flash\n");
 	printf(" -h, --help                this help\n\n");
 }
 
@@ -86,6 +98,9 @@ int main(int argc, char* argv[])
 	int desired_temperature;
 	char mode[5];
 	char timer_string[10];
+	char hexfile[255];
+	int baudrate = 38400;
+	int force = 0;
 
 	strcpy(serialPort,"/dev/ttyS0");
 
@@ -94,7 +109,7 @@ int main(int argc, char* argv[])
 	{
 		int option_index = 0;
 
-		c = getopt_long(argc, argv, "p:t:hdm:ga:", long_options, &option_index);
+		c = getopt_long(argc, argv, "p:t:hdm:gka:f:b:F", long_options, &option_index);
 
 		if( c == -1 )
 			break;
@@ -117,6 +132,9 @@ int main(int argc, char* argv[])
 			case 'g': 	flags |= FLAG_TIMERS;
 					break;
 
+			case 'k': 	flags |= FLAG_MOTOR_LOG;
+					break;
+
 			case 'a': 	flags |= FLAG_SET_TIMER;
 					if(strlen(optarg) <=10)
 					{
@@ -133,6 +151,21 @@ int main(int argc, char* argv[])
 					flags |= FLAG_MODE;
 					break;
 
+			case 'f': 	if(strlen(optarg) >= sizeof(hexfile))
+					{
+						printf("file name too long\n");
+						exit(1);
+					}
+					strcpy(hexfile, optarg);
+					flags |= FLAG_FLASH;
+					break;
+
+			case 'b': 	baudrate = atoi(optarg);
+					break;
+
+			case 'F': 	force = 1;
+					break;
+
 			default: abort();
 		}
 	}
@@ -144,6 +177,13 @@ int main(int argc, char* argv[])
 	}
 	
 
+	if(flags & FLAG_FLASH)
+	{
+		if(!hr20Flash(hexfile, baudrate, force))
+			exit(1);
+		return 0;
+	}
+
 	if(flags & FLAG_DATETIME)
 	{
 		hr20SetDateAndTime();
@@ -177,6 +217,11 @@ int main(int argc, char* argv[])
 		hr20GetAllTimers();
 	}
 
+	if(flags & FLAG_MOTOR_LOG)
+	{
+		hr20GetMotorLog();
+	}
+
 	if(flags & FLAG_SET_TIMER)
 	{
 		if(strlen(timer_string) == 2)
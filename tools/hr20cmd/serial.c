@@ -29,6 +29,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <sys/select.h>
 #include "serial.h"
 
 int fd;
@@ -122,3 +123,88 @@ int serialCommand(char *command, char *buffer)
 }
 
 
+
+/*!
+ ********************************************************************************
+ * serialRaw
+ *
+ * switch the port to binary mode (no line processing) with given speed,
+ * used for bootloader communication
+ *
+ * \param speed termios speed constant (B9600, B38400, ...)
+ * \returns 1 on success, 0 on failure
+ *******************************************************************************/
+int serialRaw(speed_t speed)
+{
+	struct termios newtio;
+
+	if(tcgetattr(fd, &newtio) < 0)
+		return 0;
+	cfmakeraw(&newtio);
+	newtio.c_cflag |= CLOCAL | CREAD;
+	newtio.c_cc[VTIME] = 0;
+	newtio.c_cc[VMIN] = 1;
+	cfsetispeed(&newtio, speed);
+	cfsetospeed(&newtio, speed);
+	tcdrain(fd);
+	return tcsetattr(fd, TCSANOW, &newtio) == 0;
+}
+
+/*!
+ ********************************************************************************
+ * serialWrite
+ *
+ * write raw bytes and wait until they are sent
+ *******************************************************************************/
+int serialWrite(const void *data, int len)
+{
+	int res = write(fd, data, len);
+	tcdrain(fd);
+	return res;
+}
+
+/*!
+ ********************************************************************************
+ * serialRead
+ *
+ * read raw bytes
+ *
+ * \param *data buffer
+ * \param len wanted bytes
+ * \param timeout_ms timeout while waiting for next bytes
+ * \returns number of bytes read, less than len on timeout
+ *******************************************************************************/
+int serialRead(void *data, int len, int timeout_ms)
+{
+	int got = 0;
+
+	while(got < len)
+	{
+		fd_set rfds;
+		struct timeval tv;
+		int res;
+
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		if(select(fd + 1, &rfds, NULL, NULL, &tv) <= 0)
+			break;
+		res = read(fd, (char *)data + got, len - got);
+		if(res <= 0)
+			break;
+		got += res;
+	}
+	return got;
+}
+
+/*!
+ ********************************************************************************
+ * serialFlush
+ *
+ * drop all received and not yet sent bytes
+ *******************************************************************************/
+void serialFlush(void)
+{
+	tcflush(fd, TCIOFLUSH);
+}
@@ -20,6 +20,8 @@
 #ifndef __SERIAL_H__
 #define __SERIAL_H__
 
+#include <termios.h>
+
 #define BAUDRATE B9600
 
 /*!
@@ -32,5 +34,10 @@ extern int initSerial(char *device);
 
 extern int serialCommand(char *command, char *buffer);
 
+extern int serialRaw(speed_t speed);
+extern int serialWrite(const void *data, int len);
+extern int serialRead(void *data, int len, int timeout_ms);
+extern void serialFlush(void);
+
 #endif
 
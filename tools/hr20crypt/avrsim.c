@@ -0,0 +1,959 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	avrsim.c
+ * \brief	small AVR interpreter for firmware assembler sources
+ *
+ * Source text is interpreted directly, avr-as is not needed. Only the
+ * instructions of xtea-asm.S and the inline assembler of wireless.c are
+ * known, anything else is a load error. Flags are computed as described
+ * in the AVR instruction set manual.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "avrsim.h"
+
+#define AVR_STEPS_MAX 1000000
+#define AVR_RET_END 0xffff
+
+enum
+{
+	OP_NOP, OP_PUSH, OP_POP, OP_MOV, OP_MOVW, OP_LDI, OP_LD, OP_ST,
+	OP_ADD, OP_ADC, OP_SUB, OP_SBC, OP_SUBI, OP_SBCI, OP_AND, OP_ANDI,
+	OP_OR, OP_ORI, OP_EOR, OP_LSR, OP_ROR, OP_INC, OP_DEC, OP_ADIW,
+	OP_SBIW, OP_SET, OP_CLT, OP_IN, OP_OUT, OP_BRBS, OP_BRBC, OP_RJMP,
+	OP_RCALL, OP_RET
+};
+
+/* pointer modes of ld/st */
+enum { PTR_PLAIN, PTR_INC, PTR_DEC, PTR_DISP };
+
+typedef struct
+{
+	int op;
+	int a, b;		/* registers, ld/st: data and pointer register */
+	int k;			/* immediate, flag mask, target or ld/st pointer mode */
+	int q;			/* ld/st displacement */
+} avr_insn_t;
+
+typedef struct
+{
+	char name[32];
+	int value;
+} avr_sym_t;
+
+struct avr_prog
+{
+	avr_insn_t *insn;
+	int n, max;
+	avr_sym_t *label;	/* global labels, value is instruction index */
+	int nlabel, maxlabel;
+};
+
+/* one source line of current avr_load() */
+typedef struct
+{
+	int lineno;
+	char mnem[8];
+	char arg[2][64];
+	int narg;
+} avr_line_t;
+
+typedef struct
+{
+	int num, idx;
+} avr_local_t;
+
+static const struct
+{
+	const char *name;
+	int op, args;
+	int k;			/* flag mask for branches */
+} mnemonics[] =
+{
+	{"nop", OP_NOP, 0, 0}, {"push", OP_PUSH, 1, 0}, {"pop", OP_POP, 1, 0},
+	{"mov", OP_MOV, 2, 0}, {"movw", OP_MOVW, 2, 0}, {"ldi", OP_LDI, 2, 0},
+	{"ld", OP_LD, 2, 0}, {"ldd", OP_LD, 2, 0}, {"st", OP_ST, 2, 0},
+	{"std", OP_ST, 2, 0}, {"add", OP_ADD, 2, 0}, {"adc", OP_ADC, 2, 0},
+	{"sub", OP_SUB, 2, 0}, {"sbc", OP_SBC, 2, 0}, {"subi", OP_SUBI, 2, 0},
+	{"sbci", OP_SBCI, 2, 0}, {"and", OP_AND, 2, 0}, {"andi", OP_ANDI, 2, 0},
+	{"or", OP_OR, 2, 0}, {"ori", OP_ORI, 2, 0}, {"eor", OP_EOR, 2, 0},
+	{"clr", OP_EOR, 1, 0}, {"lsl", OP_ADD, 1, 0}, {"rol", OP_ADC, 1, 0},
+	{"lsr", OP_LSR, 1, 0}, {"ror", OP_ROR, 1, 0}, {"inc", OP_INC, 1, 0},
+	{"dec", OP_DEC, 1, 0}, {"adiw", OP_ADIW, 2, 0}, {"sbiw", OP_SBIW, 2, 0},
+	{"set", OP_SET, 0, 0}, {"clt", OP_CLT, 0, 0}, {"in", OP_IN, 2, 0},
+	{"out", OP_OUT, 2, 0},
+	{"breq", OP_BRBS, 1, AVR_SREG_Z}, {"brne", OP_BRBC, 1, AVR_SREG_Z},
+	{"brcs", OP_BRBS, 1, AVR_SREG_C}, {"brcc", OP_BRBC, 1, AVR_SREG_C},
+	{"brlo", OP_BRBS, 1, AVR_SREG_C}, {"brsh", OP_BRBC, 1, AVR_SREG_C},
+	{"brts", OP_BRBS, 1, AVR_SREG_T}, {"brtc", OP_BRBC, 1, AVR_SREG_T},
+	{"rjmp", OP_RJMP, 1, 0}, {"rcall", OP_RCALL, 1, 0}, {"ret", OP_RET, 0, 0},
+};
+
+/* symbols of current avr_load(), "V01 = 2" */
+static avr_sym_t *syms;
+static int nsyms;
+static const char *err_src;
+static int err_line;
+
+static void load_error(const char *msg, const char *s)
+{
+	fprintf(stderr, "avrsim: %s line %d: %s '%s'\n", err_src, err_line, msg, s);
+}
+
+avr_prog_t *avr_prog_new(void)
+{
+	return calloc(1, sizeof(avr_prog_t));
+}
+
+void avr_prog_free(avr_prog_t *p)
+{
+	if(p == NULL)
+		return;
+	free(p->insn);
+	free(p->label);
+	free(p);
+}
+
+char *avr_read_file(const char *name)
+{
+	FILE *f = fopen(name, "rb");
+	char *s;
+	long n;
+
+	if(f == NULL)
+		return NULL;
+	fseek(f, 0, SEEK_END);
+	n = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	s = malloc(n+1);
+	if(s && fread(s, 1, n, f) != (size_t)n)
+	{
+		free(s);
+		s = NULL;
+	}
+	if(s)
+		s[n] = '\0';
+	fclose(f);
+	return s;
+}
+
+/*!
+ ********************************************************************************
+ * avr_asm_from_c
+ *
+ * assembler text of top level asm() statement in C source which defines label,
+ * string literals are joined and escapes \n \t \" \\ resolved
+ *
+ * \returns malloc()ed text or NULL
+ *******************************************************************************/
+char *avr_asm_from_c(const char *csrc, const char *label)
+{
+	char def[40];
+	const char *p, *start = NULL, *l;
+	char *out, *o;
+
+	snprintf(def, sizeof(def), "\"%s:", label);
+	l = strstr(csrc, def);
+	if(l == NULL)
+	{
+		snprintf(def, sizeof(def), "%s:", label);
+		l = strstr(csrc, def);
+	}
+	if(l == NULL)
+		return NULL;
+	for(p=csrc;p<l;p++)
+		if(strncmp(p, "asm", 3) == 0 && (p == csrc || !isalnum((unsigned char)p[-1])))
+			start = p;
+	if(start == NULL)
+		return NULL;
+	out = o = malloc(strlen(start)+1);
+	if(out == NULL)
+		return NULL;
+	for(p=start;*p && *p != ';';p++)
+	{
+		if(p[0] == '/' && p[1] == '/')
+		{
+			while(*p && *p != '\n')
+				p++;
+			continue;
+		}
+		if(p[0] == '/' && p[1] == '*')
+		{
+			p = strstr(p+2, "*/");
+			if(p == NULL)
+				break;
+			p++;
+			continue;
+		}
+		if(*p != '"')
+			continue;
+		for(p++;*p && *p != '"';p++)
+		{
+			if(*p == '\\' && p[1])
+			{
+				p++;
+				*o++ = (*p == 'n') ? '\n' : (*p == 't') ? '\t' : *p;
+			}
+			else
+				*o++ = *p;
+		}
+		if(*p == '\0')
+			break;
+	}
+	*o = '\0';
+	return out;
+}
+
+static int find_sym(const avr_sym_t *s, int n, const char *name)
+{
+	int i;
+	for(i=0;i<n;i++)
+		if(strcmp(s[i].name, name) == 0)
+			return i;
+	return -1;
+}
+
+/* expression: C operators | ^ & << >> + - * / unary - ~, lo8() hi8() */
+static long expr(const char **s, int *ok);
+
+static void skip_space(const char **s)
+{
+	while(**s == ' ' || **s == '\t')
+		(*s)++;
+}
+
+static long primary(const char **s, int *ok)
+{
+	long v = 0;
+
+	skip_space(s);
+	if(**s == '(')
+	{
+		(*s)++;
+		v = expr(s, ok);
+		skip_space(s);
+		if(**s != ')')
+			*ok = 0;
+		else
+			(*s)++;
+		return v;
+	}
+	if(**s == '-')
+	{
+		(*s)++;
+		return -primary(s, ok);
+	}
+	if(**s == '~')
+	{
+		(*s)++;
+		return ~primary(s, ok);
+	}
+	if(isdigit((unsigned char)**s))
+	{
+		char *e;
+		v = strtol(*s, &e, 0);
+		*s = e;
+		return v;
+	}
+	if(isalpha((unsigned char)**s) || **s == '_')
+	{
+		char name[32];
+		int n = 0, i;
+		while((isalnum((unsigned char)**s) || **s == '_') && n < 31)
+			name[n++] = *(*s)++;
+		name[n] = '\0';
+		if(strcmp(name, "lo8") == 0 || strcmp(name, "hi8") == 0)
+		{
+			v = primary(s, ok);
+			return (name[0] == 'l') ? (v & 0xff) : ((v >> 8) & 0xff);
+		}
+		i = find_sym(syms, nsyms, name);
+		if(i < 0)
+		{
+			load_error("unknown symbol", name);
+			*ok = 0;
+			return 0;
+		}
+		return syms[i].value;
+	}
+	*ok = 0;
+	return 0;
+}
+
+static long term(const char **s, int *ok)
+{
+	long v = primary(s, ok);
+	for(;;)
+	{
+		skip_space(s);
+		if(**s == '*')
+		{
+			(*s)++;
+			v *= primary(s, ok);
+		}
+		else if(**s == '/')
+		{
+			long d;
+			(*s)++;
+			d = primary(s, ok);
+			if(d == 0)
+				*ok = 0;
+			else
+				v /= d;
+		}
+		else
+			return v;
+	}
+}
+
+static long sum(const char **s, int *ok)
+{
+	long v = term(s, ok);
+	for(;;)
+	{
+		skip_space(s);
+		if(**s == '+')
+		{
+			(*s)++;
+			v += term(s, ok);
+		}
+		else if(**s == '-')
+		{
+			(*s)++;
+			v -= term(s, ok);
+		}
+		else
+			return v;
+	}
+}
+
+static long shift(const char **s, int *ok)
+{
+	long v = sum(s, ok);
+	for(;;)
+	{
+		skip_space(s);
+		if((*s)[0] == '<' && (*s)[1] == '<')
+		{
+			*s += 2;
+			v <<= sum(s, ok);
+		}
+		else if((*s)[0] == '>' && (*s)[1] == '>')
+		{
+			*s += 2;
+			v >>= sum(s, ok);
+		}
+		else
+			return v;
+	}
+}
+
+static long expr(const char **s, int *ok)
+{
+	long v = shift(s, ok);
+	for(;;)
+	{
+		skip_space(s);
+		if(**s == '&')
+		{
+			(*s)++;
+			v &= shift(s, ok);
+		}
+		else if(**s == '^')
+		{
+			(*s)++;
+			v ^= shift(s, ok);
+		}
+		else if(**s == '|')
+		{
+			(*s)++;
+			v |= shift(s, ok);
+		}
+		else
+			return v;
+	}
+}
+
+static int value(const char *s, long *v)
+{
+	int ok = 1;
+	*v = expr(&s, &ok);
+	skip_space(&s);
+	if(!ok || *s)
+	{
+		load_error("bad expression", s);
+		return 0;
+	}
+	return 1;
+}
+
+static int reg(const char *s)
+{
+	long v;
+
+	if((s[0] == 'r' || s[0] == 'R') && isdigit((unsigned char)s[1]))
+		v = strtol(s+1, NULL, 10);
+	else if(strcmp(s, "__tmp_reg__") == 0)
+		v = 0;
+	else if(strcmp(s, "__zero_reg__") == 0)
+		v = 1;
+	else if(!value(s, &v))
+		return -1;
+	if(v < 0 || v > 31)
+	{
+		load_error("bad register", s);
+		return -1;
+	}
+	return v;
+}
+
+/* X X+ -X Y+q Z ..., sets pointer register, mode and displacement */
+static int pointer(const char *s, avr_insn_t *in)
+{
+	const char *org = s;
+	long q = 0;
+
+	in->k = PTR_PLAIN;
+	if(*s == '-')
+	{
+		in->k = PTR_DEC;
+		s++;
+	}
+	switch(toupper((unsigned char)*s))
+	{
+		case 'X': in->b = 26; break;
+		case 'Y': in->b = 28; break;
+		case 'Z': in->b = 30; break;
+		default: load_error("bad pointer", org); return 0;
+	}
+	s++;
+	if(*s == '+' && s[1] == '\0' && in->k == PTR_PLAIN)
+		in->k = PTR_INC;
+	else if(*s == '+' && in->b != 26 && in->k == PTR_PLAIN)
+	{
+		if(!value(s+1, &q) || q < 0 || q > 63)
+			return 0;
+		in->k = PTR_DISP;
+		in->q = q;
+	}
+	else if(*s)
+	{
+		load_error("bad pointer", org);
+		return 0;
+	}
+	return 1;
+}
+
+/* io register, only SREG and SP are known */
+static int io(const char *s)
+{
+	long v;
+
+	if(strcmp(s, "__SREG__") == 0)
+		return 0x3f;
+	if(strcmp(s, "__SP_L__") == 0)
+		return 0x3d;
+	if(strcmp(s, "__SP_H__") == 0)
+		return 0x3e;
+	if(!value(s, &v))
+		return -1;
+	if(v != 0x3d && v != 0x3e && v != 0x3f)
+	{
+		load_error("unknown io register", s);
+		return -1;
+	}
+	return v;
+}
+
+static int target(const char *s, int idx, const avr_local_t *loc, int nloc,
+		const avr_prog_t *p)
+{
+	int i, n, best = -1;
+	size_t len = strlen(s);
+
+	if(len > 1 && isdigit((unsigned char)s[0]) && (s[len-1] == 'b' || s[len-1] == 'f'))
+	{
+		n = atoi(s);
+		for(i=0;i<nloc;i++)
+		{
+			if(loc[i].num != n)
+				continue;
+			if(s[len-1] == 'b' && loc[i].idx <= idx)
+				best = loc[i].idx;
+			if(s[len-1] == 'f' && loc[i].idx > idx && best < 0)
+				best = loc[i].idx;
+		}
+	}
+	else
+	{
+		i = find_sym(p->label, p->nlabel, s);
+		if(i >= 0)
+			best = p->label[i].value;
+	}
+	if(best < 0)
+		load_error("unknown label", s);
+	return best;
+}
+
+static int add_label(avr_prog_t *p, const char *name, int idx)
+{
+	if(find_sym(p->label, p->nlabel, name) >= 0)
+	{
+		load_error("duplicate label", name);
+		return 0;
+	}
+	if(p->nlabel == p->maxlabel)
+	{
+		p->maxlabel = p->maxlabel ? 2*p->maxlabel : 16;
+		p->label = realloc(p->label, p->maxlabel*sizeof(avr_sym_t));
+	}
+	snprintf(p->label[p->nlabel].name, sizeof(p->label[0].name), "%s", name);
+	p->label[p->nlabel++].value = idx;
+	return 1;
+}
+
+static int defined(const char *defines, const char *name)
+{
+	size_t n = strlen(name);
+	const char *d = defines;
+
+	while(d && (d = strstr(d, name)) != NULL)
+	{
+		if((d == defines || d[-1] == ' ') && (d[n] == ' ' || d[n] == '\0'))
+			return 1;
+		d += n;
+	}
+	return 0;
+}
+
+/*!
+ ********************************************************************************
+ * avr_load
+ *
+ * append assembler source to program
+ *
+ * \param *src source text, comments ; // and C style are removed,
+ *	#ifdef/#ifndef/#else/#endif are evaluated, other # lines ignored
+ * \param *defines names defined for #ifdef, separated by space
+ * \returns 0 on error
+ *******************************************************************************/
+int avr_load(avr_prog_t *p, const char *src, const char *defines)
+{
+	char *text = strdup(src), *line, *next;
+	avr_line_t *lines = NULL;
+	avr_local_t *loc = NULL;
+	int nlines = 0, nloc = 0, first = p->n, i, ok = 1;
+	int skip[16], depth = 0;
+	char *c;
+
+	if(text == NULL)
+		return 0;
+	err_src = "source";
+	/* C comments, newlines are kept for line numbers */
+	for(c=text;(c=strstr(c, "/*"))!=NULL;)
+	{
+		char *e = strstr(c+2, "*/");
+		if(e == NULL)
+			e = c+strlen(c)-2;
+		for(;c<e+2;c++)
+			if(*c != '\n')
+				*c = ' ';
+	}
+	free(syms);
+	syms = NULL;
+	nsyms = 0;
+	skip[0] = 0;
+	lines = malloc(sizeof(avr_line_t)*(strlen(text)/2+2));
+	loc = malloc(sizeof(avr_local_t)*(strlen(text)/2+2));
+	for(line=text,err_line=1;line && ok;line=next,err_line++)
+	{
+		char *s, *colon;
+
+		next = strchr(line, '\n');
+		if(next)
+			*next++ = '\0';
+		if((c = strchr(line, ';')) != NULL)
+			*c = '\0';
+		if((c = strstr(line, "//")) != NULL)
+			*c = '\0';
+		for(s=line;isspace((unsigned char)*s);s++)
+			;
+		for(c=s+strlen(s);c>s && isspace((unsigned char)c[-1]);)
+			*--c = '\0';
+		if(*s == '#')
+		{
+			char name[32] = "";
+			sscanf(s, "#%*s %31s", name);
+			if(strncmp(s, "#ifdef", 6) == 0 || strncmp(s, "#ifndef", 7) == 0)
+			{
+				int d = defined(defines, name);
+				if(depth+1 >= (int)(sizeof(skip)/sizeof(skip[0])))
+				{
+					load_error("too deep", s);
+					ok = 0;
+					break;
+				}
+				depth++;
+				skip[depth] = skip[depth-1] || (s[3] == 'd' ? !d : d);
+			}
+			else if(strncmp(s, "#else", 5) == 0 && depth > 0)
+				skip[depth] = skip[depth-1] || !skip[depth];
+			else if(strncmp(s, "#endif", 6) == 0 && depth > 0)
+				depth--;
+			continue;
+		}
+		if(skip[depth] || *s == '\0' || *s == '.')
+			continue;
+		/* symbol = value */
+		if((c = strchr(s, '=')) != NULL)
+		{
+			long v;
+			char name[32];
+			if(sscanf(s, "%31[A-Za-z0-9_] =", name) != 1 || !value(c+1, &v))
+			{
+				ok = 0;
+				break;
+			}
+			syms = realloc(syms, (nsyms+1)*sizeof(avr_sym_t));
+			snprintf(syms[nsyms].name, sizeof(syms[0].name), "%s", name);
+			syms[nsyms++].value = v;
+			continue;
+		}
+		/* labels */
+		while((colon = strchr(s, ':')) != NULL)
+		{
+			*colon = '\0';
+			if(isdigit((unsigned char)*s))
+			{
+				loc[nloc].num = atoi(s);
+				loc[nloc++].idx = first+nlines;
+			}
+			else if(!add_label(p, s, first+nlines))
+			{
+				ok = 0;
+				break;
+			}
+			for(s=colon+1;isspace((unsigned char)*s);s++)
+				;
+		}
+		if(!ok || *s == '\0')
+			continue;
+		/* mnemonic and arguments */
+		memset(&lines[nlines], 0, sizeof(avr_line_t));
+		lines[nlines].lineno = err_line;
+		sscanf(s, "%7s", lines[nlines].mnem);
+		for(c=lines[nlines].mnem;*c;c++)
+			*c = tolower((unsigned char)*c);
+		s += strlen(lines[nlines].mnem);
+		while(*s && lines[nlines].narg < 2)
+		{
+			char *a = lines[nlines].arg[lines[nlines].narg++];
+			int n = 0;
+			while(isspace((unsigned char)*s))
+				s++;
+			while(*s && *s != ',' && n < 63)
+				a[n++] = *s++;
+			while(n && isspace((unsigned char)a[n-1]))
+				n--;
+			a[n] = '\0';
+			if(*s == ',')
+				s++;
+		}
+		nlines++;
+	}
+	if(ok && p->n+nlines > p->max)
+	{
+		p->max = p->n+nlines;
+		p->insn = realloc(p->insn, p->max*sizeof(avr_insn_t));
+	}
+	for(i=0;ok && i<nlines;i++)
+	{
+		avr_line_t *l = &lines[i];
+		avr_insn_t *in = &p->insn[p->n];
+		unsigned int m;
+		long v = 0;
+
+		err_line = l->lineno;
+		for(m=0;m<sizeof(mnemonics)/sizeof(mnemonics[0]);m++)
+			if(strcmp(mnemonics[m].name, l->mnem) == 0)
+				break;
+		if(m == sizeof(mnemonics)/sizeof(mnemonics[0]) || l->narg != mnemonics[m].args)
+		{
+			load_error("unknown instruction", l->mnem);
+			ok = 0;
+			break;
+		}
+		memset(in, 0, sizeof(*in));
+		in->op = mnemonics[m].op;
+		in->k = mnemonics[m].k;
+		switch(in->op)
+		{
+			case OP_NOP: case OP_SET: case OP_CLT: case OP_RET:
+				break;
+			case OP_BRBS: case OP_BRBC: case OP_RJMP: case OP_RCALL:
+				in->a = target(l->arg[0], p->n, loc, nloc, p);
+				ok = in->a >= 0;
+				break;
+			case OP_LD:
+				ok = (in->a = reg(l->arg[0])) >= 0 && pointer(l->arg[1], in);
+				break;
+			case OP_ST:
+				ok = (in->a = reg(l->arg[1])) >= 0 && pointer(l->arg[0], in);
+				break;
+			case OP_IN:
+				ok = (in->a = reg(l->arg[0])) >= 0 && (in->b = io(l->arg[1])) >= 0;
+				break;
+			case OP_OUT:
+				ok = (in->b = io(l->arg[0])) >= 0 && (in->a = reg(l->arg[1])) >= 0;
+				break;
+			case OP_LDI: case OP_SUBI: case OP_SBCI: case OP_ANDI: case OP_ORI:
+			case OP_ADIW: case OP_SBIW:
+				ok = (in->a = reg(l->arg[0])) >= 0 && value(l->arg[1], &v);
+				in->k = v;
+				break;
+			default:
+				ok = (in->a = reg(l->arg[0])) >= 0;
+				in->b = in->a; /* clr lsl rol: both operands same register */
+				if(ok && l->narg == 2)
+					ok = (in->b = reg(l->arg[1])) >= 0;
+				break;
+		}
+		if(!ok)
+			break;
+		p->n++;
+	}
+	free(lines);
+	free(loc);
+	free(text);
+	return ok;
+}
+
+static void flag(avr_cpu_t *c, uint8_t mask, int set)
+{
+	if(set)
+		c->sreg |= mask;
+	else
+		c->sreg &= ~mask;
+}
+
+/* N Z S from result, V must be set before */
+static void flags_nzs(avr_cpu_t *c, uint8_t r)
+{
+	flag(c, AVR_SREG_N, r & 0x80);
+	flag(c, AVR_SREG_Z, r == 0);
+	flag(c, AVR_SREG_S, !(c->sreg & AVR_SREG_N) != !(c->sreg & AVR_SREG_V));
+}
+
+static uint8_t add8(avr_cpu_t *c, uint8_t d, uint8_t s, int carry)
+{
+	uint8_t r = d+s+carry;
+	uint8_t cy = (d & s) | (s & ~r) | (~r & d);
+
+	flag(c, AVR_SREG_H, cy & 0x08);
+	flag(c, AVR_SREG_C, cy & 0x80);
+	flag(c, AVR_SREG_V, ((d & s & ~r) | (~d & ~s & r)) & 0x80);
+	flags_nzs(c, r);
+	return r;
+}
+
+/* keep_z: sbc/sbci clear Z only */
+static uint8_t sub8(avr_cpu_t *c, uint8_t d, uint8_t s, int carry, int keep_z)
+{
+	uint8_t r = d-s-carry;
+	uint8_t bw = (~d & s) | (s & r) | (r & ~d);
+	int z = c->sreg & AVR_SREG_Z;
+
+	flag(c, AVR_SREG_H, bw & 0x08);
+	flag(c, AVR_SREG_C, bw & 0x80);
+	flag(c, AVR_SREG_V, ((d & ~s & ~r) | (~d & s & r)) & 0x80);
+	flags_nzs(c, r);
+	if(keep_z)
+		flag(c, AVR_SREG_Z, r == 0 && z);
+	return r;
+}
+
+static uint8_t logic8(avr_cpu_t *c, uint8_t r)
+{
+	flag(c, AVR_SREG_V, 0);
+	flags_nzs(c, r);
+	return r;
+}
+
+static void push(avr_cpu_t *c, uint8_t v)
+{
+	c->mem[c->sp--] = v;
+}
+
+static uint8_t pop(avr_cpu_t *c)
+{
+	return c->mem[++c->sp];
+}
+
+/*!
+ ********************************************************************************
+ * avr_call
+ *
+ * run program from label until its ret, registers, SREG, SP and memory are
+ * taken from *c and left there; caller sets r1 to 0 as avr-gcc does
+ *
+ * \returns 0 on error (unknown label, memory out of range, no ret)
+ *******************************************************************************/
+int avr_call(const avr_prog_t *p, avr_cpu_t *c, const char *label)
+{
+	long steps;
+	int pc, i;
+
+	i = find_sym(p->label, p->nlabel, label);
+	if(i < 0)
+	{
+		fprintf(stderr, "avrsim: unknown label '%s'\n", label);
+		return 0;
+	}
+	pc = p->label[i].value;
+	push(c, AVR_RET_END & 0xff);
+	push(c, AVR_RET_END >> 8);
+	for(steps=0;steps<AVR_STEPS_MAX;steps++)
+	{
+		const avr_insn_t *in;
+		uint8_t *d, cy;
+		uint16_t w, r;
+
+		if(pc == AVR_RET_END)
+			return 1;
+		if(pc < 0 || pc >= p->n || c->sp < 0x100 || c->sp >= AVR_RAM)
+			break;
+		in = &p->insn[pc++];
+		d = &c->r[in->a & 31]; /* a is target index for branches */
+		cy = c->sreg & AVR_SREG_C;
+		switch(in->op)
+		{
+			case OP_NOP: break;
+			case OP_PUSH: push(c, *d); break;
+			case OP_POP: *d = pop(c); break;
+			case OP_MOV: *d = c->r[in->b]; break;
+			case OP_MOVW:
+				c->r[in->a & ~1] = c->r[in->b & ~1];
+				c->r[in->a | 1] = c->r[in->b | 1];
+				break;
+			case OP_LDI: *d = in->k; break;
+			case OP_LD:
+			case OP_ST:
+				w = c->r[in->b] | (c->r[in->b+1] << 8);
+				if(in->k == PTR_DEC)
+					w--;
+				if(in->k == PTR_DISP)
+					w += in->q;
+				if(w < 0x100 || w >= AVR_RAM)
+				{
+					fprintf(stderr, "avrsim: access 0x%04x out of SRAM\n", w);
+					return 0;
+				}
+				if(in->op == OP_LD)
+					*d = c->mem[w];
+				else
+					c->mem[w] = *d;
+				if(in->k == PTR_INC)
+					w++;
+				if(in->k == PTR_INC || in->k == PTR_DEC)
+				{
+					c->r[in->b] = w & 0xff;
+					c->r[in->b+1] = w >> 8;
+				}
+				break;
+			case OP_ADD: *d = add8(c, *d, c->r[in->b], 0); break;
+			case OP_ADC: *d = add8(c, *d, c->r[in->b], cy); break;
+			case OP_SUB: *d = sub8(c, *d, c->r[in->b], 0, 0); break;
+			case OP_SBC: *d = sub8(c, *d, c->r[in->b], cy, 1); break;
+			case OP_SUBI: *d = sub8(c, *d, in->k, 0, 0); break;
+			case OP_SBCI: *d = sub8(c, *d, in->k, cy, 1); break;
+			case OP_AND: *d = logic8(c, *d & c->r[in->b]); break;
+			case OP_ANDI: *d = logic8(c, *d & in->k); break;
+			case OP_OR: *d = logic8(c, *d | c->r[in->b]); break;
+			case OP_ORI: *d = logic8(c, *d | in->k); break;
+			case OP_EOR: *d = logic8(c, *d ^ c->r[in->b]); break;
+			case OP_LSR:
+			case OP_ROR:
+				flag(c, AVR_SREG_C, *d & 1);
+				*d = (*d >> 1) | ((in->op == OP_ROR && cy) ? 0x80 : 0);
+				flag(c, AVR_SREG_N, *d & 0x80);
+				flag(c, AVR_SREG_V, !(c->sreg & AVR_SREG_N) != !(c->sreg & AVR_SREG_C));
+				flags_nzs(c, *d);
+				break;
+			case OP_INC:
+				flag(c, AVR_SREG_V, *d == 0x7f);
+				flags_nzs(c, ++*d);
+				break;
+			case OP_DEC:
+				flag(c, AVR_SREG_V, *d == 0x80);
+				flags_nzs(c, --*d);
+				break;
+			case OP_ADIW:
+			case OP_SBIW:
+				w = d[0] | (d[1] << 8);
+				r = (in->op == OP_ADIW) ? w+in->k : w-in->k;
+				if(in->op == OP_ADIW)
+				{
+					flag(c, AVR_SREG_C, !(r & 0x8000) && (w & 0x8000));
+					flag(c, AVR_SREG_V, (r & 0x8000) && !(w & 0x8000));
+				}
+				else
+				{
+					flag(c, AVR_SREG_C, (r & 0x8000) && !(w & 0x8000));
+					flag(c, AVR_SREG_V, !(r & 0x8000) && (w & 0x8000));
+				}
+				d[0] = r & 0xff;
+				d[1] = r >> 8;
+				flag(c, AVR_SREG_N, r & 0x8000);
+				flag(c, AVR_SREG_Z, r == 0);
+				flag(c, AVR_SREG_S, !(c->sreg & AVR_SREG_N) != !(c->sreg & AVR_SREG_V));
+				break;
+			case OP_SET: c->sreg |= AVR_SREG_T; break;
+			case OP_CLT: c->sreg &= ~AVR_SREG_T; break;
+			case OP_IN:
+				*d = (in->b == 0x3f) ? c->sreg : (in->b == 0x3d) ? (c->sp & 0xff) : (c->sp >> 8);
+				break;
+			case OP_OUT:
+				if(in->b == 0x3f)
+					c->sreg = *d;
+				else if(in->b == 0x3d)
+					c->sp = (c->sp & 0xff00) | *d;
+				else
+					c->sp = (c->sp & 0x00ff) | (*d << 8);
+				break;
+			case OP_BRBS: if(c->sreg & in->k) pc = in->a; break;
+			case OP_BRBC: if(!(c->sreg & in->k)) pc = in->a; break;
+			case OP_RJMP: pc = in->a; break;
+			case OP_RCALL:
+				push(c, pc & 0xff);
+				push(c, pc >> 8);
+				pc = in->a;
+				break;
+			case OP_RET:
+				pc = pop(c) << 8;
+				pc |= pop(c);
+				break;
+		}
+	}
+	fprintf(stderr, "avrsim: '%s' stopped at instruction %d\n", label, pc);
+	return 0;
+}
@@ -0,0 +1,54 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	avrsim.h
+ * \brief	small AVR interpreter for firmware assembler sources
+ */
+
+#ifndef __AVRSIM_H__
+#define __AVRSIM_H__
+
+#include <stdint.h>
+
+#define AVR_RAM 0x900		/* ATmega169: SRAM up to 0x8ff */
+#define AVR_SREG_C 0x01
+#define AVR_SREG_Z 0x02
+#define AVR_SREG_N 0x04
+#define AVR_SREG_V 0x08
+#define AVR_SREG_S 0x10
+#define AVR_SREG_H 0x20
+#define AVR_SREG_T 0x40
+
+typedef struct
+{
+	uint8_t r[32];
+	uint8_t sreg;
+	uint16_t sp;
+	uint8_t mem[AVR_RAM];
+} avr_cpu_t;
+
+typedef struct avr_prog avr_prog_t;
+
+avr_prog_t *avr_prog_new(void);
+void avr_prog_free(avr_prog_t *p);
+int avr_load(avr_prog_t *p, const char *src, const char *defines);
+char *avr_asm_from_c(const char *csrc, const char *label);
+char *avr_read_file(const char *name);
+int avr_call(const avr_prog_t *p, avr_cpu_t *c, const char *label);
+
+#endif
@@ -0,0 +1,373 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	frame.c
+ * \brief	key setup, CMAC and encryption of radio frames, single and batch
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "xtea.h"
+#include "frame.h"
+
+static const uint8_t Km_upper[8] = {
+	0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef
+};
+
+/*!
+ ********************************************************************************
+ * left_roll
+ *
+ * same as left_roll in wireless.c: 64 bit little endian rotate left,
+ * MSB of byte 7 goes to LSB of byte 0
+ *******************************************************************************/
+static void left_roll(uint8_t *dest, const uint8_t *src)
+{
+	uint8_t c = src[7]>>7;
+	int i;
+
+	for(i=0;i<8;i++)
+	{
+		uint8_t t = src[i];
+		dest[i] = (t<<1) | c;
+		c = t>>7;
+	}
+}
+
+/*!
+ ********************************************************************************
+ * hr20_keys_init
+ *
+ * same key derivation as crypto_init() in wireless.c
+ *
+ * \param *keys output
+ * \param *security_key 8 bytes, config.security_key of the devices
+ *******************************************************************************/
+void hr20_keys_init(hr20_keys_t *keys, const uint8_t *security_key)
+{
+	uint8_t *K_m = HR20_K1(keys);	/* K_m shares memory with K1,K2 */
+	int i;
+
+	memcpy(K_m, security_key, 8);
+	memcpy(K_m+8, Km_upper, 8);
+	for(i=0;i<3*8;i++)
+		keys->k[i] = 0xc0+i;
+	xtea_enc(HR20_K_MAC(keys), HR20_K_MAC(keys), K_m);
+	xtea_enc(HR20_K_ENC(keys), HR20_K_ENC(keys), K_m);
+	xtea_enc(HR20_K_ENC(keys)+8, HR20_K_ENC(keys)+8, K_m);
+	memset(HR20_K1(keys), 0, 8);
+	xtea_enc(HR20_K1(keys), HR20_K1(keys), HR20_K_MAC(keys));
+	left_roll(HR20_K1(keys), HR20_K1(keys));
+	left_roll(HR20_K2(keys), HR20_K1(keys));
+}
+
+/* CMAC input block x of message m, last block is padded and xored with K1/K2 */
+static void cmac_block(const hr20_keys_t *keys, const uint8_t *m, size_t bytes, size_t x, uint8_t *blk)
+{
+	size_t end = x+8;
+	const uint8_t *Kx = NULL;
+	int j;
+
+	if(end >= bytes)
+		Kx = (end == bytes) ? HR20_K1(keys) : HR20_K2(keys);
+	for(j=0;j<8;j++,x++)
+	{
+		uint8_t tmp;
+		if(x < bytes)
+			tmp = m[x];
+		else
+			tmp = (x == bytes) ? 0x80 : 0;
+		if(Kx)
+			tmp ^= Kx[j];
+		blk[j] = tmp;
+	}
+}
+
+/*!
+ ********************************************************************************
+ * hr20_cmac
+ *
+ * same as cmac_calc() in cmac.c
+ *
+ * \param *m message, MAC is stored to / compared with m[bytes..bytes+3]
+ * \param bytes message length
+ * \param *prefix 8 byte prefix (nonce) or NULL
+ * \param check 0 = store MAC, 1 = compare MAC
+ * \returns 1 if MAC matches (always 1 for store)
+ *******************************************************************************/
+int hr20_cmac(const hr20_keys_t *keys, uint8_t *m, size_t bytes, const uint8_t *prefix, int check)
+{
+	uint8_t buf[8], blk[8];
+	size_t i;
+	int j;
+
+	if(prefix == NULL)
+		memset(buf, 0, 8);
+	else
+		xtea_enc(buf, prefix, HR20_K_MAC(keys));
+
+	for(i=0;i<bytes;i+=8)
+	{
+		cmac_block(keys, m, bytes, i, blk);
+		for(j=0;j<8;j++)
+			buf[j] ^= blk[j];
+		xtea_enc(buf, buf, HR20_K_MAC(keys));
+	}
+	if(check)
+		return memcmp(m+bytes, buf, 4) == 0;
+	memcpy(m+bytes, buf, 4);
+	return 1;
+}
+
+/*!
+ ********************************************************************************
+ * hr20_crypt
+ *
+ * same as encrypt_decrypt() in wireless.c, pkt_cnt in nonce is incremented
+ * for each started 8 byte block
+ *******************************************************************************/
+void hr20_crypt(const hr20_keys_t *keys, uint8_t *nonce, uint8_t *p, size_t len)
+{
+	uint8_t buf[8];
+	size_t i;
+
+	for(i=0;i<len;i++)
+	{
+		if((i&7) == 0)
+		{
+			xtea_enc(buf, nonce, HR20_K_ENC(keys));
+			nonce[HR20_NONCE_PKT_CNT]++;
+		}
+		p[i] ^= buf[i&7];
+	}
+}
+
+/*!
+ ********************************************************************************
+ * hr20_frame_encode
+ *
+ * build data frame like wirelessSendPacket()
+ *
+ * \param *nonce rtc_t of sender, pkt_cnt is updated
+ * \param addr sender address (0 = master)
+ * \param *frame output buffer, len+6 bytes
+ * \returns frame length (value of length byte)
+ *******************************************************************************/
+size_t hr20_frame_encode(const hr20_keys_t *keys, uint8_t *nonce, uint8_t addr,
+		const uint8_t *data, size_t len, uint8_t *frame)
+{
+	size_t flen = len+2+4;
+
+	frame[0] = flen;
+	frame[1] = addr;
+	memcpy(frame+2, data, len);
+	hr20_crypt(keys, nonce, frame+2, len);
+	hr20_cmac(keys, frame+1, flen-5, nonce, 0);
+	nonce[HR20_NONCE_PKT_CNT]++;
+	return flen;
+}
+
+/* length byte check from wirelessReceivePacket(), returns used length or 0 */
+static size_t frame_len(const uint8_t *frame, size_t len)
+{
+	size_t flen;
+
+	if(len < 1)
+		return 0;
+	flen = frame[0] & 0x7f;
+	if(flen >= HR20_FRAME_MAX || flen < 4+2 || len < flen)
+		return 0;
+	return flen;
+}
+
+/*!
+ ********************************************************************************
+ * hr20_frame_decode
+ *
+ * verify and decrypt data frame in place like wirelessReceivePacket()
+ *
+ * \param *nonce rtc_t of receiver, pkt_cnt is updated
+ * \param *frame received bytes, length byte first
+ * \param len number of received bytes
+ * \returns 1 = MAC ok, 0 = bad MAC or invalid frame
+ *******************************************************************************/
+int hr20_frame_decode(const hr20_keys_t *keys, uint8_t *nonce, uint8_t *frame, size_t len)
+{
+	size_t flen = frame_len(frame, len);
+	uint8_t nblocks;
+	int ok;
+
+	if(flen == 0 || (frame[0] & 0x80))
+		return 0;
+	nblocks = (flen+7-2-4)/8;
+	nonce[HR20_NONCE_PKT_CNT] += nblocks;
+	ok = hr20_cmac(keys, frame+1, flen-1-4, nonce, 1);
+	nonce[HR20_NONCE_PKT_CNT] -= nblocks;
+	hr20_crypt(keys, nonce, frame+2, flen-2-4);
+	nonce[HR20_NONCE_PKT_CNT]++;
+	return ok;
+}
+
+/*!
+ ********************************************************************************
+ * hr20_sync_encode
+ *
+ * build sync frame like wirelessSendSync(), data is not encrypted
+ *
+ * \returns frame length without 0x80 flag
+ *******************************************************************************/
+size_t hr20_sync_encode(const hr20_keys_t *keys, const uint8_t *data, size_t len, uint8_t *frame)
+{
+	frame[0] = (len+1+4) | 0x80;
+	memcpy(frame+1, data, len);
+	hr20_cmac(keys, frame+1, len, NULL, 0);
+	return len+1+4;
+}
+
+int hr20_sync_verify(const hr20_keys_t *keys, uint8_t *frame, size_t len)
+{
+	size_t flen = frame_len(frame, len);
+
+	if(flen == 0 || !(frame[0] & 0x80))
+		return 0;
+	return hr20_cmac(keys, frame+1, flen-5, NULL, 1);
+}
+
+/*!
+ ********************************************************************************
+ * hr20_frames_decode
+ *
+ * hr20_frame_decode() for many frames at once, sync frames are verified only
+ *
+ * Each frame is an independent CMAC chain, so step s of all chains is
+ * one xtea_enc_blocks() call (SIMD lanes run different frames). All
+ * keystream blocks and all nonce prefixes are single calls too.
+ * Nonces in f[] are not modified.
+ *******************************************************************************/
+void hr20_frames_decode(const hr20_keys_t *keys, hr20_frame_t *f, size_t n)
+{
+	uint8_t *state, *ks, *tmp;
+	size_t *idx, *ks_pos;
+	size_t i, k, m, nks = 0;
+	int s, j;
+
+	state = calloc(n, 8);
+	tmp = malloc(8*n);
+	idx = malloc(sizeof(size_t)*n);
+	ks_pos = malloc(sizeof(size_t)*n);
+	if(!state || !tmp || !idx || !ks_pos)
+	{
+		/* no memory for batch, do it one by one */
+		for(i=0;i<n;i++)
+		{
+			uint8_t nonce[8];
+			memcpy(nonce, f[i].nonce, 8);
+			if(f[i].len && (f[i].frame[0] & 0x80))
+				f[i].ok = hr20_sync_verify(keys, f[i].frame, f[i].len);
+			else
+				f[i].ok = hr20_frame_decode(keys, nonce, f[i].frame, f[i].len);
+		}
+		goto out;
+	}
+
+	/* CMAC start values: E(nonce with pkt_cnt+nblocks) or zero for sync */
+	for(i=0;i<n;i++)
+	{
+		size_t flen = frame_len(f[i].frame, f[i].len);
+		f[i].ok = (flen != 0);
+		ks_pos[i] = nks;
+		memcpy(state+8*i, f[i].nonce, 8);
+		if(flen && !(f[i].frame[0] & 0x80))
+		{
+			state[8*i+HR20_NONCE_PKT_CNT] += (flen+7-2-4)/8;
+			nks += (flen+7-2-4)/8;
+		}
+	}
+	xtea_enc_blocks(state, state, n, HR20_K_MAC(keys));
+	for(i=0;i<n;i++)
+		if(f[i].ok && (f[i].frame[0] & 0x80))
+			memset(state+8*i, 0, 8);
+
+	/* CMAC chains, message is frame+1 with flen-5 bytes for both frame types */
+	for(s=0;s*8<HR20_FRAME_MAX;s++)
+	{
+		m = 0;
+		for(i=0;i<n;i++)
+		{
+			size_t bytes;
+			if(!f[i].ok)
+				continue;
+			bytes = (f[i].frame[0] & 0x7f)-5;
+			if((size_t)s*8 >= bytes)
+				continue;
+			cmac_block(keys, f[i].frame+1, bytes, s*8, tmp+8*m);
+			for(j=0;j<8;j++)
+				tmp[8*m+j] ^= state[8*i+j];
+			idx[m++] = i;
+		}
+		if(m == 0)
+			break;
+		xtea_enc_blocks(tmp, tmp, m, HR20_K_MAC(keys));
+		for(k=0;k<m;k++)
+			memcpy(state+8*idx[k], tmp+8*k, 8);
+	}
+	for(i=0;i<n;i++)
+		if(f[i].ok)
+			f[i].ok = memcmp(f[i].frame+(f[i].frame[0] & 0x7f)-4, state+8*i, 4) == 0;
+
+	/* keystream for all data frames, decrypted even with bad MAC like firmware */
+	ks = malloc(8*nks+1);
+	if(ks == NULL)
+	{
+		for(i=0;i<n;i++)
+		{
+			uint8_t nonce[8];
+			memcpy(nonce, f[i].nonce, 8);
+			if(f[i].len && !(f[i].frame[0] & 0x80) && frame_len(f[i].frame, f[i].len))
+				hr20_crypt(keys, nonce, f[i].frame+2, (f[i].frame[0] & 0x7f)-2-4);
+		}
+		goto out;
+	}
+	for(i=0;i<n;i++)
+	{
+		size_t nb = (i+1<n ? ks_pos[i+1] : nks) - ks_pos[i];
+		for(k=0;k<nb;k++)
+		{
+			memcpy(ks+8*(ks_pos[i]+k), f[i].nonce, 8);
+			ks[8*(ks_pos[i]+k)+HR20_NONCE_PKT_CNT] += k;
+		}
+	}
+	xtea_enc_blocks(ks, ks, nks, HR20_K_ENC(keys));
+	for(i=0;i<n;i++)
+	{
+		size_t nb = (i+1<n ? ks_pos[i+1] : nks) - ks_pos[i];
+		size_t dlen;
+		if(nb == 0)
+			continue;
+		dlen = (f[i].frame[0] & 0x7f)-2-4;
+		for(k=0;k<dlen;k++)
+			f[i].frame[2+k] ^= ks[8*ks_pos[i]+k];
+	}
+	free(ks);
+out:
+	free(state);
+	free(tmp);
+	free(idx);
+	free(ks_pos);
+}
@@ -0,0 +1,67 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	frame.h
+ * \brief	OpenHR20 radio frame crypto, compatible with rfmsrc/common/wireless.c and cmac.c
+ *
+ * Frames start with the length byte (rfm_framebuf[0] on receive side):
+ *
+ *  data frame: [len][addr][encrypted data, len-6 bytes][mac 4 bytes]
+ *  sync frame: [len|0x80][plain data, (len&0x7f)-5 bytes][mac 4 bytes]
+ *
+ * Nonce is the 8 byte rtc_t structure (YY MM DD hh mm ss DOW pkt_cnt).
+ */
+
+#ifndef __FRAME_H__
+#define __FRAME_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define HR20_FRAME_MAX 80	/* RFM_FRAME_MAX */
+#define HR20_NONCE_PKT_CNT 7
+
+/*! same layout as Keys[] in wireless.c */
+typedef struct {
+	uint8_t k[5*8];
+} hr20_keys_t;
+
+#define HR20_K_MAC(x) ((x)->k)
+#define HR20_K_ENC(x) ((x)->k+8)
+#define HR20_K1(x) ((x)->k+24)
+#define HR20_K2(x) ((x)->k+32)
+
+/*! one frame for hr20_frames_decode */
+typedef struct {
+	uint8_t nonce[8];	/*!< rtc_t of receiver before this frame */
+	uint8_t *frame;		/*!< length byte first, decrypted in place */
+	size_t len;		/*!< received bytes */
+	int ok;			/*!< result, 1 = MAC ok */
+} hr20_frame_t;
+
+extern void hr20_keys_init(hr20_keys_t *keys, const uint8_t *security_key);
+extern int hr20_cmac(const hr20_keys_t *keys, uint8_t *m, size_t bytes, const uint8_t *prefix, int check);
+extern void hr20_crypt(const hr20_keys_t *keys, uint8_t *nonce, uint8_t *p, size_t len);
+extern size_t hr20_frame_encode(const hr20_keys_t *keys, uint8_t *nonce, uint8_t addr,
+		const uint8_t *data, size_t len, uint8_t *frame);
+extern int hr20_frame_decode(const hr20_keys_t *keys, uint8_t *nonce, uint8_t *frame, size_t len);
+extern size_t hr20_sync_encode(const hr20_keys_t *keys, const uint8_t *data, size_t len, uint8_t *frame);
+extern int hr20_sync_verify(const hr20_keys_t *keys, uint8_t *frame, size_t len);
+extern void hr20_frames_decode(const hr20_keys_t *keys, hr20_frame_t *f, size_t n);
+
+#endif
@@ -0,0 +1,214 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	fwvec.c
+ * \brief	test vectors for hr20crypt computed by the firmware code
+ *
+ * xtea_enc and left_roll run in avrsim from rfmsrc/common/xtea-asm.S and
+ * the asm() of wireless.c, cmac_calc() is rfmsrc/common/cmac.c compiled
+ * for the host. Nothing of frame.c / xtea.c is used, so hr20crypt -s
+ * checks the host library against the firmware, not against itself.
+ * Output is pasted to the vectors in hr20crypt.c.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fw/config.h"
+#include "../../rfmsrc/common/xtea.h"
+#include "../../rfmsrc/common/wireless.h"
+#include "../../rfmsrc/common/cmac.h"
+#include "avrsim.h"
+
+#ifndef FW_DIR
+#define FW_DIR "../../rfmsrc/common"
+#endif
+
+/* SRAM of the interpreted functions, rest of avr_cpu_t.mem is stack */
+#define SRAM_DEST 0x100
+#define SRAM_BLOCK 0x108
+#define SRAM_KEY 0x110
+#define SRAM_KEYS 0x200
+
+uint8_t Keys[5*8];
+static uint8_t RTC[8];		/* rtc_t of the sender, pkt_cnt is RTC[7] */
+static uint8_t rfm_framebuf[80];
+static avr_prog_t *prog;
+static avr_cpu_t cpu;
+
+static const uint8_t Km_upper[8] = {
+	0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef
+};
+
+static void cpu_reset(void)
+{
+	memset(&cpu, 0, sizeof(cpu));
+	cpu.sp = AVR_RAM-1;
+}
+
+static void run(const char *label)
+{
+	if(!avr_call(prog, &cpu, label))
+		exit(1);
+}
+
+/* firmware xtea_enc(), avr-gcc calling convention */
+void xtea_enc(void *dest, const void *v, const void *k)
+{
+	cpu_reset();
+	memcpy(cpu.mem+SRAM_BLOCK, v, 8);
+	memcpy(cpu.mem+SRAM_KEY, k, 16);
+	cpu.r[24] = SRAM_DEST & 0xff; cpu.r[25] = SRAM_DEST >> 8;
+	cpu.r[22] = SRAM_BLOCK & 0xff; cpu.r[23] = SRAM_BLOCK >> 8;
+	cpu.r[20] = SRAM_KEY & 0xff; cpu.r[21] = SRAM_KEY >> 8;
+	run("xtea_enc");
+	memcpy(dest, cpu.mem+SRAM_DEST, 8);
+}
+
+/* left_roll of wireless.c, Y source and Z destination are inside Keys */
+static void left_roll(uint8_t *dest, uint8_t *src)
+{
+	uint16_t y = SRAM_KEYS+(src-Keys), z = SRAM_KEYS+(dest-Keys);
+
+	cpu_reset();
+	memcpy(cpu.mem+SRAM_KEYS, Keys, sizeof(Keys));
+	cpu.r[28] = y & 0xff; cpu.r[29] = y >> 8;
+	cpu.r[30] = z & 0xff; cpu.r[31] = z >> 8;
+	run("left_roll");
+	memcpy(Keys, cpu.mem+SRAM_KEYS, sizeof(Keys));
+}
+
+/* crypto_init() of wireless.c, the asm() part calls left_roll twice */
+static void fw_crypto_init(const uint8_t *security_key)
+{
+	uint8_t i;
+	memcpy(K_m,security_key,8);
+	memcpy(K_m+8,Km_upper,sizeof(Km_upper));
+	for (i=0;i<3*8;i++) {
+		Keys[i]=0xc0+i;
+	}
+	xtea_enc(K_mac, K_mac, K_m);
+	xtea_enc(K_enc, K_enc, K_m);
+	xtea_enc(K_enc+8, K_enc+8, K_m);
+	for (i=0;i<8;i++) {
+		K1[i]=0;
+	}
+	xtea_enc(K1, K1, K_mac);
+	left_roll(K1, K1);
+	left_roll(K2, K1);
+}
+
+/* encrypt_decrypt() of wireless.c */
+static void encrypt_decrypt (uint8_t* p, uint8_t len) {
+	uint8_t i=0;
+	uint8_t buf[8];
+	while(i<len) {
+		xtea_enc(buf,RTC,K_enc);
+		RTC[7]++;
+		do {
+			p[i]^=buf[i&7];
+			i++;
+			if (i>=len) return; //done
+		} while ((i&7)!=0);
+	}
+}
+
+static void print_hex(const char *name, const uint8_t *p, int n)
+{
+	int i;
+	printf("%s ", name);
+	for(i=0;i<n;i++)
+		printf("%02x", p[i]);
+	printf("\n");
+}
+
+/* slave wirelessSendPacket(), without preamble and dummy bytes */
+static void send_packet(uint8_t addr, const char *data)
+{
+	uint8_t rfm_framesize;
+
+	rfm_framebuf[5] = addr;
+	rfm_framesize = strlen(data)+2+4;
+	memcpy(rfm_framebuf+6, data, strlen(data));
+	rfm_framebuf[4] = rfm_framesize;
+	encrypt_decrypt(rfm_framebuf+6, rfm_framesize-4-2);
+	cmac_calc(rfm_framebuf+5, rfm_framesize-5, RTC, false);
+	RTC[7]++;
+	printf("frame \"%s\"", data);
+	print_hex("", rfm_framebuf+4, rfm_framesize);
+}
+
+/* master wirelessSendSync() */
+static void send_sync(const uint8_t *data, uint8_t n)
+{
+	rfm_framebuf[4] = (n+1+4) | 0x80;
+	memcpy(rfm_framebuf+5, data, n);
+	cmac_calc(rfm_framebuf+5, n, NULL, false);
+	print_hex("sync", rfm_framebuf+4, n+1+4);
+}
+
+int main(int argc, char **argv)
+{
+	static const char *plain[] = {"", "D", "12345678", "Hello OpenHR20!!x"};
+	static const uint8_t nonce[8] = {0x0a, 0x0a, 0x13, 0x0c, 0x22, 0x38, 0x00, 0x00};
+	static const uint8_t key[8] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+	static const uint8_t sync[4] = {0x0a, 0xa9, 0x9a, 0x45};
+	/* standard XTEA vector in AVR byte order */
+	static const uint8_t xkey[16] = {3,2,1,0, 7,6,5,4, 11,10,9,8, 15,14,13,12};
+	static const uint8_t xin[8] = {0x44, 0x43, 0x42, 0x41, 0x48, 0x47, 0x46, 0x45};
+	const char *dir = (argc > 1) ? argv[1] : FW_DIR;
+	char name[512], *src, *s;
+	uint8_t buf[8];
+	unsigned int i;
+
+	prog = avr_prog_new();
+	snprintf(name, sizeof(name), "%s/xtea-asm.S", dir);
+	src = avr_read_file(name);
+	if(src == NULL || !avr_load(prog, src, "XTEA_ENC"))
+	{
+		fprintf(stderr, "can't load %s\n", name);
+		return 1;
+	}
+	free(src);
+	snprintf(name, sizeof(name), "%s/wireless.c", dir);
+	src = avr_read_file(name);
+	s = src ? avr_asm_from_c(src, "left_roll") : NULL;
+	if(s == NULL || !avr_load(prog, s, ""))
+	{
+		fprintf(stderr, "can't load left_roll from %s\n", name);
+		return 1;
+	}
+	free(s);
+	free(src);
+
+	xtea_enc(buf, xin, xkey);
+	print_hex("xtea", buf, 8);
+
+	fw_crypto_init(key);
+	print_hex("keys", Keys, sizeof(Keys));
+
+	for(i=0;i<sizeof(plain)/sizeof(plain[0]);i++)
+	{
+		memcpy(RTC, nonce, 8);
+		send_packet(0x11, plain[i]);
+	}
+	send_sync(sync, sizeof(sync));
+	avr_prog_free(prog);
+	return 0;
+}
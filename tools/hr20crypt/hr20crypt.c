@@ -0,0 +1,427 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	hr20crypt.c
+ * \brief	verify / decrypt captured OpenHR20 frames, selftest and benchmark
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "xtea.h"
+#include "frame.h"
+
+#define HR20CRYPT_VERSION "0.1"
+#define BATCH_FRAMES 4096
+
+static struct option long_options[] =
+{
+	{"key", required_argument, 0, 'k'},
+	{"verify", required_argument, 0, 'v'},
+	{"impl", required_argument, 0, 'i'},
+	{"selftest", no_argument, 0, 's'},
+	{"bench", no_argument, 0, 'b'},
+	{"help", no_argument, 0, 'h'},
+	{0,0,0,0}
+};
+
+static void printUsage(void)
+{
+	printf("hr20crypt version %s\n", HR20CRYPT_VERSION);
+	printf("Options:\n\n");
+	printf(" -k, --key hex             security key, 16 hex digits (default 0123456789abcdef)\n");
+	printf(" -v, --verify file         verify and decrypt capture file, - for stdin\n");
+	printf("                           line format: <nonce 16 hex> <frame hex, length byte first>\n");
+	printf(" -i, --impl name           force scalar/sse2/avx2\n");
+	printf(" -s, --selftest            run test vectors\n");
+	printf(" -b, --bench               measure frames per second\n");
+	printf(" -h, --help                this help\n\n");
+}
+
+static int hexToBin(const char *s, uint8_t *out, size_t max)
+{
+	size_t n = 0;
+	unsigned int v;
+
+	while(s[0] && s[1] && s[0] != ' ' && s[0] != '\t' && s[0] != '\n' && s[0] != '\r')
+	{
+		if(n >= max || sscanf(s, "%2x", &v) != 1)
+			return -1;
+		out[n++] = v;
+		s += 2;
+	}
+	return n;
+}
+
+static void printHex(const uint8_t *p, size_t n)
+{
+	size_t i;
+	for(i=0;i<n;i++)
+		printf("%02x", p[i]);
+}
+
+/*
+ * vectors, key 0123456789abcdef, nonce 0a0a130c22380000 (sender pkt_cnt 0),
+ * sender address 0x11; the standard XTEA vector is given in AVR byte order.
+ * Output of hr20fwvec: firmware xtea-asm.S, left_roll and cmac.c, not this library.
+ */
+static const char *tv_xtea_key = "03020100070605040b0a09080f0e0d0c";
+static const char *tv_xtea_in = "4443424148474645";
+static const char *tv_xtea_out = "d0f37d49b52c6172";
+static const char *tv_keys = "3bd6f1a6ac20b2b40e5980938abab58830a4f9c72fd6ffd6"
+		"5e06d88e3d1a683ebc0cb01d7b34d07c";
+static const char *tv_nonce = "0a0a130c22380000";
+static const struct {
+	const char *plain;
+	const char *frame;
+} tv_frames[] = {
+	{"", "0611149c424e"},
+	{"D", "0711fcc65c6ebf"},
+	{"12345678", "0e1189774f8e7480343ccbf265ee"},
+	{"Hello OpenHR20!!x", "1711f02010d62e964c74bc4492b03f00e4cd51348c25df"},
+};
+static const char *tv_sync = "890aa99a455f7c77d0";
+
+static int check(const char *name, const uint8_t *got, const char *hex)
+{
+	uint8_t want[HR20_FRAME_MAX];
+	int n = hexToBin(hex, want, sizeof(want));
+
+	if(n < 0 || memcmp(got, want, n) != 0)
+	{
+		printf("FAIL %s: got ", name);
+		printHex(got, n < 0 ? 0 : n);
+		printf(" want %s\n", hex);
+		return 1;
+	}
+	printf("ok   %s\n", name);
+	return 0;
+}
+
+static int selftest(void)
+{
+	static const xtea_impl_t impls[] = {XTEA_IMPL_SCALAR, XTEA_IMPL_SSE2, XTEA_IMPL_AVX2};
+	uint8_t sec[8], key[16], buf[HR20_FRAME_MAX], nonce[8];
+	uint8_t *a, *b;
+	hr20_keys_t keys;
+	hr20_frame_t f[64];
+	uint8_t fb[64][HR20_FRAME_MAX];
+	int err = 0;
+	size_t i, n;
+	unsigned int k;
+
+	hexToBin(tv_xtea_key, key, 16);
+	hexToBin(tv_xtea_in, buf, 8);
+	xtea_enc(buf, buf, key);
+	err |= check("xtea_enc", buf, tv_xtea_out);
+	xtea_dec(buf, buf, key);
+	err |= check("xtea_dec", buf, tv_xtea_in);
+
+	hexToBin("0123456789abcdef", sec, 8);
+	hr20_keys_init(&keys, sec);
+	err |= check("crypto_init", keys.k, tv_keys);
+
+	hexToBin(tv_nonce, nonce, 8);
+	for(i=0;i<sizeof(tv_frames)/sizeof(tv_frames[0]);i++)
+	{
+		char name[32];
+		size_t len = strlen(tv_frames[i].plain);
+		uint8_t rx[8];
+
+		memcpy(rx, nonce, 8);
+		sprintf(name, "encode frame %d", (int)i);
+		hr20_frame_encode(&keys, nonce, 0x11, (const uint8_t *)tv_frames[i].plain, len, buf);
+		err |= check(name, buf, tv_frames[i].frame);
+		sprintf(name, "decode frame %d", (int)i);
+		if(!hr20_frame_decode(&keys, rx, buf, len+6) || memcmp(rx, nonce, 8)
+				|| memcmp(buf+2, tv_frames[i].plain, len))
+		{
+			printf("FAIL %s\n", name);
+			err = 1;
+		}
+		else
+			printf("ok   %s\n", name);
+		hexToBin(tv_nonce, nonce, 8);
+	}
+	buf[0] = 10; buf[1] = 0xa9; buf[2] = 0x9a; buf[3] = 0x45;
+	hr20_sync_encode(&keys, buf, 4, fb[0]);
+	err |= check("sync encode", fb[0], tv_sync);
+	fb[0][2] ^= 1;
+	if(hr20_sync_verify(&keys, fb[0], 9))
+	{
+		printf("FAIL sync bad MAC accepted\n");
+		err = 1;
+	}
+
+	/* all block paths must give the same result as xtea_enc */
+	n = 1000;
+	a = malloc(8*n);
+	b = malloc(8*n);
+	for(i=0;i<8*n;i++)
+		a[i] = i*7+3;
+	for(k=0;k<sizeof(impls)/sizeof(impls[0]);k++)
+	{
+		char name[32];
+		int bad = 0;
+		xtea_impl_t got = xtea_set_impl(impls[k]);
+		if(got != impls[k])
+		{
+			printf("skip %s (not supported by CPU)\n", xtea_impl_name(impls[k]));
+			continue;
+		}
+		for(size_t m=0;m<=n;m+=(m<20 ? 1 : 97))
+		{
+			xtea_enc_blocks(b, a, m, key);
+			for(i=0;i<m;i++)
+			{
+				xtea_enc(buf, a+8*i, key);
+				if(memcmp(buf, b+8*i, 8))
+					bad = 1;
+			}
+		}
+		sprintf(name, "xtea_enc_blocks %s", xtea_impl_name(impls[k]));
+		printf("%s %s\n", bad ? "FAIL" : "ok  ", name);
+		err |= bad;
+
+		/* batch decode, mixed sizes, bad MAC and sync frames */
+		hexToBin(tv_nonce, nonce, 8);
+		for(i=0;i<64;i++)
+		{
+			uint8_t data[HR20_FRAME_MAX];
+			size_t len = (i*5) % (HR20_FRAME_MAX-6);
+			memset(data, (int)i, len);
+			memcpy(f[i].nonce, nonce, 8);
+			f[i].frame = fb[i];
+			if(i % 9 == 8)
+				f[i].len = hr20_sync_encode(&keys, data, len < 60 ? len : 60, fb[i]);
+			else
+				f[i].len = hr20_frame_encode(&keys, nonce, i, data, len, fb[i]);
+			if(i % 13 == 12)
+				fb[i][f[i].len-1] ^= 0x40;
+		}
+		hr20_frames_decode(&keys, f, 64);
+		bad = 0;
+		for(i=0;i<64;i++)
+		{
+			size_t j, len = (i*5) % (HR20_FRAME_MAX-6);
+			if(f[i].ok != !(i % 13 == 12))
+				bad = 1;
+			if(!(fb[i][0] & 0x80))
+				for(j=0;j<len;j++)
+					if(fb[i][2+j] != (uint8_t)i)
+						bad = 1;
+		}
+		sprintf(name, "hr20_frames_decode %s", xtea_impl_name(impls[k]));
+		printf("%s %s\n", bad ? "FAIL" : "ok  ", name);
+		err |= bad;
+	}
+	free(a);
+	free(b);
+	xtea_set_impl(XTEA_IMPL_AUTO);
+	printf(err ? "selftest FAILED\n" : "selftest passed\n");
+	return err;
+}
+
+static double now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+static void bench(const hr20_keys_t *keys, xtea_impl_t forced)
+{
+	static const xtea_impl_t impls[] = {XTEA_IMPL_SCALAR, XTEA_IMPL_SSE2, XTEA_IMPL_AVX2};
+	size_t n = 200000, i;
+	uint8_t (*fb)[HR20_FRAME_MAX] = malloc(n*HR20_FRAME_MAX);
+	uint8_t (*org)[HR20_FRAME_MAX] = malloc(n*HR20_FRAME_MAX);
+	hr20_frame_t *f = malloc(n*sizeof(hr20_frame_t));
+	uint8_t nonce[8] = {10, 10, 19, 12, 0, 0, 0, 0};
+	unsigned int k;
+
+	for(i=0;i<n;i++)
+	{
+		uint8_t data[24];
+		memset(data, (int)i, sizeof(data));
+		memcpy(f[i].nonce, nonce, 8);
+		f[i].len = hr20_frame_encode(keys, nonce, i & 0x7f, data, 10 + i % 14, org[i]);
+		f[i].frame = fb[i];
+	}
+	for(k=0;k<sizeof(impls)/sizeof(impls[0]);k++)
+	{
+		double t;
+		size_t ok = 0;
+		if(forced != XTEA_IMPL_AUTO && forced != impls[k])
+			continue;
+		if(xtea_set_impl(impls[k]) != impls[k])
+			continue;
+		memcpy(fb, org, n*HR20_FRAME_MAX);
+		t = now();
+		for(i=0;i<n;i+=BATCH_FRAMES)
+			hr20_frames_decode(keys, f+i, n-i < BATCH_FRAMES ? n-i : BATCH_FRAMES);
+		t = now()-t;
+		for(i=0;i<n;i++)
+			ok += f[i].ok;
+		printf("%-7s %8.0f frames/s (%zu/%zu ok)\n", xtea_impl_name(impls[k]), n/t, ok, n);
+	}
+	free(fb);
+	free(org);
+	free(f);
+}
+
+/*
+ * read capture, decode in batches of BATCH_FRAMES
+ * output: OK|ERR <nonce> <decrypted frame>
+ */
+static int verify(const hr20_keys_t *keys, const char *file)
+{
+	FILE *in = strcmp(file, "-") ? fopen(file, "r") : stdin;
+	hr20_frame_t *f = malloc(BATCH_FRAMES*sizeof(hr20_frame_t));
+	uint8_t (*fb)[HR20_FRAME_MAX] = malloc(BATCH_FRAMES*HR20_FRAME_MAX);
+	char line[512];
+	size_t n = 0, i, total = 0, bad = 0;
+	int eof = 0;
+
+	if(in == NULL)
+	{
+		perror(file);
+		return 1;
+	}
+	while(!eof)
+	{
+		char *p;
+		int len;
+
+		if(fgets(line, sizeof(line), in) == NULL)
+			eof = 1;
+		else
+		{
+			if(line[0] == '#' || line[0] == '\n')
+				continue;
+			p = strchr(line, ' ');
+			if(p == NULL || hexToBin(line, f[n].nonce, 8) != 8)
+				continue;
+			while(*p == ' ')
+				p++;
+			len = hexToBin(p, fb[n], HR20_FRAME_MAX);
+			if(len <= 0)
+				continue;
+			f[n].frame = fb[n];
+			f[n].len = len;
+			n++;
+		}
+		if(n == BATCH_FRAMES || (eof && n))
+		{
+			hr20_frames_decode(keys, f, n);
+			for(i=0;i<n;i++)
+			{
+				printf("%s ", f[i].ok ? "OK " : "ERR");
+				printHex(f[i].nonce, 8);
+				printf(" ");
+				printHex(f[i].frame, f[i].len);
+				printf("\n");
+				bad += !f[i].ok;
+			}
+			total += n;
+			n = 0;
+		}
+	}
+	if(in != stdin)
+		fclose(in);
+	free(f);
+	free(fb);
+	fprintf(stderr, "%zu frames, %zu bad\n", total, bad);
+	return bad != 0;
+}
+
+int main(int argc, char* argv[])
+{
+	uint8_t sec[8] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+	xtea_impl_t impl = XTEA_IMPL_AUTO;
+	hr20_keys_t keys;
+	const char *file = NULL;
+	int do_selftest = 0, do_bench = 0;
+	int c;
+
+	while(1)
+	{
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "k:v:i:sbh", long_options, &option_index);
+
+		if( c == -1 )
+			break;
+
+		switch(c)
+		{
+			case 'k':	if(strlen(optarg) != 16 || hexToBin(optarg, sec, 8) != 8)
+					{
+						printf("error in key\n");
+						exit(1);
+					}
+					break;
+
+			case 'v':	file = optarg;
+					break;
+
+			case 'i':	if(!strcmp(optarg, "scalar"))
+						impl = XTEA_IMPL_SCALAR;
+					else if(!strcmp(optarg, "sse2"))
+						impl = XTEA_IMPL_SSE2;
+					else if(!strcmp(optarg, "avx2"))
+						impl = XTEA_IMPL_AVX2;
+					else
+					{
+						printf("error in impl\n");
+						exit(1);
+					}
+					break;
+
+			case 's':	do_selftest = 1;
+					break;
+
+			case 'b':	do_bench = 1;
+					break;
+
+			case 'h':	printUsage();
+					exit(0);
+
+			default: exit(1);
+		}
+	}
+
+	if(do_selftest)
+		return selftest();
+
+	hr20_keys_init(&keys, sec);
+	if(do_bench)
+	{
+		bench(&keys, impl);
+		return 0;
+	}
+	if(file == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+	xtea_set_impl(impl);
+	return verify(&keys, file);
+}
@@ -0,0 +1,325 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	hr20ota.c
+ * \brief	make signed firmware delta for update over wireless (rfmsrc/OpenHR20/ota.c)
+ *
+ * Delta is stored to staging area below bootloader and applied by bootloader:
+ *
+ *  header:  'D' version base_pages crc_h crc_l
+ *  records: addr_h addr_l count data[count], count 0 ends
+ *
+ * Output are master commands, one per line:
+ *
+ *  Z000000000000               begin
+ *  O<idx><count><data>         chunk of delta, WL_BLOCK_MAX bytes
+ *  Z<len><mac>                 commit, slave reboot to bootloader
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include "xtea.h"
+#include "frame.h"
+#include "../../rfmsrc/common/flash_layout.h"	/* OTA_STAGE_START, OTA_STAGE_SIZE */
+
+#define HR20OTA_VERSION "0.1"
+
+#define OTA_PAGE_SIZE 128		/* SPM_PAGESIZE */
+#define OTA_CHUNK 16			/* WL_BLOCK_MAX */
+#define OTA_VERSION 1
+#define OTA_RECORD_GAP 4		/* unchanged bytes which are cheaper than new record */
+
+static uint8_t old_image[OTA_STAGE_START];
+static uint8_t new_image[OTA_STAGE_START];
+static uint8_t delta[OTA_STAGE_SIZE + 4];	/* + mac */
+
+static struct option long_options[] =
+{
+	{"key", required_argument, 0, 'k'},
+	{"addr", required_argument, 0, 'a'},
+	{"old", required_argument, 0, 'o'},
+	{"new", required_argument, 0, 'n'},
+	{"help", no_argument, 0, 'h'},
+	{0,0,0,0}
+};
+
+static void printUsage(void)
+{
+	printf("hr20ota version %s\n", HR20OTA_VERSION);
+	printf("Options:\n\n");
+	printf(" -k, --key hex             security key, 16 hex digits (default 0123456789abcdef)\n");
+	printf(" -a, --addr hex            slave address, commands get master queue prefix (aa-0)\n");
+	printf(" -o, --old file            running firmware, intel hex\n");
+	printf(" -n, --new file            new firmware, intel hex\n");
+	printf(" -h, --help                this help\n\n");
+}
+
+static int hexByte(const char *s)
+{
+	int v;
+
+	if(sscanf(s, "%2x", &v) != 1)
+		return -1;
+	return v;
+}
+
+/*!
+ ********************************************************************************
+ * readHex
+ *
+ * load intel hex file, unused bytes are 0xff
+ *
+ * \returns image size rounded up to whole pages, -1 on error
+ *******************************************************************************/
+static int readHex(const char *file, uint8_t *image)
+{
+	FILE *f = fopen(file, "r");
+	char line[600];
+	uint32_t base = 0;
+	uint32_t end = 0;
+
+	if(!f)
+	{
+		fprintf(stderr, "Could not open %s\n", file);
+		return -1;
+	}
+	memset(image, 0xff, OTA_STAGE_START);
+	while(fgets(line, sizeof(line), f))
+	{
+		int len, type, i;
+		uint32_t addr;
+		uint8_t sum;
+
+		if(line[0] != ':')
+			continue;
+		len = hexByte(line + 1);
+		addr = (hexByte(line + 3) << 8) | hexByte(line + 5);
+		type = hexByte(line + 7);
+		if(len < 0 || type < 0 || strlen(line) < (size_t)(11 + 2 * len))
+			goto error;
+		sum = len + (addr >> 8) + addr + type + hexByte(line + 9 + 2 * len);
+		for(i = 0; i < len; i++)
+			sum += hexByte(line + 9 + 2 * i);
+		if(sum != 0)
+			goto error;
+
+		if(type == 0)
+		{
+			addr += base;
+			if(addr + len > OTA_STAGE_START)
+			{
+				fprintf(stderr, "%s overlaps staging area at 0x%04x\n", file, OTA_STAGE_START);
+				fclose(f);
+				return -1;
+			}
+			for(i = 0; i < len; i++)
+				image[addr + i] = hexByte(line + 9 + 2 * i);
+			if(addr + len > end)
+				end = addr + len;
+		}
+		else if(type == 1)
+			break;
+		else if(type == 2)
+			base = ((hexByte(line + 9) << 8) | hexByte(line + 11)) << 4;
+		else if(type == 4)
+			base = ((hexByte(line + 9) << 8) | hexByte(line + 11)) << 16;
+	}
+	fclose(f);
+	return (end + OTA_PAGE_SIZE - 1) / OTA_PAGE_SIZE * OTA_PAGE_SIZE;
+
+error:
+	fprintf(stderr, "Bad record in %s: %s", file, line);
+	fclose(f);
+	return -1;
+}
+
+static uint16_t crc16(const uint8_t *data, int len)
+{
+	uint16_t crc = 0;
+	int i;
+
+	while(len--)
+	{
+		crc ^= (uint16_t)*data++ << 8;
+		for(i = 0; i < 8; i++)
+			crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+	}
+	return crc;
+}
+
+/*!
+ ********************************************************************************
+ * makeDelta
+ *
+ * literal records of changed bytes, near changes are merged to one record
+ *
+ * \param base bytes of flash which must match old image
+ * \returns delta length, -1 if it does not fit to staging area
+ *******************************************************************************/
+static int makeDelta(int base)
+{
+	int len = 0;
+	int a = 0;
+
+	delta[len++] = 'D';
+	delta[len++] = OTA_VERSION;
+	delta[len++] = base / OTA_PAGE_SIZE;
+	delta[len++] = crc16(old_image, base) >> 8;
+	delta[len++] = crc16(old_image, base) & 0xff;
+
+	while(a < base)
+	{
+		int start, end, gap;
+
+		if(old_image[a] == new_image[a])
+		{
+			a++;
+			continue;
+		}
+		start = a;
+		end = a + 1;
+		for(gap = 0, a++; a < base && a - start < 255 && gap < OTA_RECORD_GAP; a++)
+		{
+			if(old_image[a] != new_image[a])
+			{
+				end = a + 1;
+				gap = 0;
+			}
+			else
+				gap++;
+		}
+		a = end;
+		if(len + 3 + (end - start) + 3 > OTA_STAGE_SIZE)
+			return -1;
+		delta[len++] = start >> 8;
+		delta[len++] = start & 0xff;
+		delta[len++] = end - start;
+		memcpy(delta + len, new_image + start, end - start);
+		len += end - start;
+	}
+	delta[len++] = 0;
+	delta[len++] = 0;
+	delta[len++] = 0;
+	return len;
+}
+
+static void printCmd(int addr, const char *cmd)
+{
+	if(addr >= 0)
+		printf("(%02x-0)", addr);
+	printf("%s\n", cmd);
+}
+
+int main(int argc, char **argv)
+{
+	uint8_t sec[8] = {0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef};
+	hr20_keys_t keys;
+	const char *old_file = NULL, *new_file = NULL;
+	char cmd[8 + 2 * OTA_CHUNK];
+	int addr = -1;
+	int old_len, new_len, len, i, j;
+	unsigned int v;
+	int c;
+
+	while(1)
+	{
+		int option_index = 0;
+
+		c = getopt_long(argc, argv, "k:a:o:n:h", long_options, &option_index);
+
+		if( c == -1 )
+			break;
+
+		switch(c)
+		{
+			case 'k':	for(i = 0; i < 8; i++)
+					{
+						if(strlen(optarg) != 16 || sscanf(optarg + 2 * i, "%2x", &v) != 1)
+						{
+							fprintf(stderr, "error in key\n");
+							exit(1);
+						}
+						sec[i] = v;
+					}
+					break;
+
+			case 'a':	if(sscanf(optarg, "%x", &v) != 1 || v < 1 || v > 0x7f)
+					{
+						fprintf(stderr, "error in addr\n");
+						exit(1);
+					}
+					addr = v;
+					break;
+
+			case 'o':	old_file = optarg;
+					break;
+
+			case 'n':	new_file = optarg;
+					break;
+
+			case 'h':	printUsage();
+					exit(0);
+
+			default: exit(1);
+		}
+	}
+
+	if(old_file == NULL || new_file == NULL)
+	{
+		printUsage();
+		return 1;
+	}
+	old_len = readHex(old_file, old_image);
+	new_len = readHex(new_file, new_image);
+	if(old_len < 0 || new_len < 0)
+		return 1;
+
+	/* pages behind old image are checked too, they are erased or stale */
+	len = makeDelta((old_len > new_len) ? old_len : new_len);
+	if(len < 0)
+	{
+		fprintf(stderr, "Delta does not fit to staging area (%d bytes), flash by cable\n", OTA_STAGE_SIZE);
+		return 1;
+	}
+
+	hr20_keys_init(&keys, sec);
+	hr20_cmac(&keys, delta, len, NULL, 0);
+	fprintf(stderr, "delta %d bytes, %d pages\n", len, (len + OTA_PAGE_SIZE - 1) / OTA_PAGE_SIZE);
+
+	printCmd(addr, "Z000000000000");
+	for(i = 0; i < (len + OTA_PAGE_SIZE - 1) / OTA_PAGE_SIZE * (OTA_PAGE_SIZE / OTA_CHUNK); i++)
+	{
+		uint8_t chunk[OTA_CHUNK];
+		int n = len - i * OTA_CHUNK;
+
+		/* rest of last page is 0xff, mac behind delta is not staged */
+		memset(chunk, 0xff, OTA_CHUNK);
+		if(n > 0)
+			memcpy(chunk, delta + i * OTA_CHUNK, (n > OTA_CHUNK) ? OTA_CHUNK : n);
+		sprintf(cmd, "O%02x%02x", i, OTA_CHUNK);
+		for(j = 0; j < OTA_CHUNK; j++)
+			sprintf(cmd + 5 + 2 * j, "%02x", chunk[j]);
+		printCmd(addr, cmd);
+	}
+	sprintf(cmd, "Z%04x%02x%02x%02x%02x", len, delta[len], delta[len + 1], delta[len + 2], delta[len + 3]);
+	printCmd(addr, cmd);
+	return 0;
+}
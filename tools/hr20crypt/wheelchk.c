@@ -0,0 +1,107 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	wheelchk.c
+ * \brief	wheel bursts through service menu arithmetic of firmware
+ *
+ * kb_wheel_wrap() and kb_wheel_range() are used by menu.c for every value
+ * which wraps around. Burst of detents is accumulated as in keyboard.c
+ * (saturated at KB_WHEEL_MAX) and applied at once, result must be the same
+ * as the same number of single steps.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "../../rfmsrc/OpenHR20/keyboard.h"
+
+static int errors;
+
+/* kb_wheel after burst of n detents (sign is direction), see keyboard.c */
+static int8_t burst(int n)
+{
+	int8_t w = 0;
+	for(; n > 0; n--)
+		if(w < KB_WHEEL_MAX) w++;
+	for(; n < 0; n++)
+		if(w > -KB_WHEEL_MAX) w--;
+	return w;
+}
+
+/* service menu value min..max, single steps */
+static void check_range(uint8_t min, uint8_t max)
+{
+	int v, n, i;
+	for(v = min; v <= max; v++)
+	{
+		for(n = -(KB_WHEEL_MAX + 2); n <= KB_WHEEL_MAX + 2; n++)
+		{
+			int8_t w = burst(n);
+			int e = v;
+			uint8_t r = kb_wheel_range(v, w, min, max);
+			for(i = 0; i < w; i++)
+				e = (e == max) ? min : e + 1;
+			for(i = 0; i > w; i--)
+				e = (e == min) ? max : e - 1;
+			if(r != e)
+			{
+				printf("FAIL range %u..%u value %d burst %d: %u, expected %d\n",
+					min, max, v, n, r, e);
+				errors++;
+			}
+		}
+	}
+}
+
+/* index 0..m-1 (service_watch_n, service_idx, dow, timer) */
+static void check_wrap(int m)
+{
+	int v, n;
+	for(v = 0; v < m; v++)
+	{
+		for(n = -(KB_WHEEL_MAX + 2); n <= KB_WHEEL_MAX + 2; n++)
+		{
+			int r = kb_wheel_wrap(v + burst(n), m);
+			int e = ((v + burst(n)) % m + m) % m;
+			if((r < 0) || (r >= m) || (r != e))
+			{
+				printf("FAIL wrap %d index %d burst %d: %d\n", m, v, n, r);
+				errors++;
+			}
+		}
+	}
+}
+
+int main(void)
+{
+	static const uint8_t ranges[][2] = {
+		{0, 1}, {0, 2}, {0, 255}, {1, 100}, {10, 60}, {250, 255}
+	};
+	static const int wraps[] = {2, 8, 9, 11, 12, 24 * 6 + 1, 255};
+	unsigned int i;
+
+	for(i = 0; i < sizeof(ranges) / sizeof(ranges[0]); i++)
+		check_range(ranges[i][0], ranges[i][1]);
+	for(i = 0; i < sizeof(wraps) / sizeof(wraps[0]); i++)
+		check_wrap(wraps[i]);
+	if(errors)
+		return 1;
+	printf("wheel burst check passed\n");
+	return 0;
+}
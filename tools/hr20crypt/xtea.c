@@ -0,0 +1,289 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	xtea.c
+ * \brief	XTEA scalar reference and SSE2/AVX2 multi block paths
+ *
+ * All blocks in one xtea_enc_blocks() call share the key, so the round
+ * keys (sum + k[...]) are scalars broadcast to all lanes and every lane
+ * holds one block. SSE2 runs 4 blocks, AVX2 8 blocks per iteration.
+ */
+
+#include <string.h>
+
+#include "xtea.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define XTEA_X86 1
+#include <immintrin.h>
+#else
+#define XTEA_X86 0
+#endif
+
+#define XTEA_DELTA 0x9E3779B9UL
+#define XTEA_ROUNDS 32
+
+static inline uint32_t ld32(const uint8_t *p)
+{
+	return (uint32_t)p[0] | ((uint32_t)p[1]<<8) | ((uint32_t)p[2]<<16) | ((uint32_t)p[3]<<24);
+}
+
+static inline void st32(uint8_t *p, uint32_t v)
+{
+	p[0] = v;
+	p[1] = v>>8;
+	p[2] = v>>16;
+	p[3] = v>>24;
+}
+
+/*!
+ ********************************************************************************
+ * xtea_round_keys
+ *
+ * precalculate (sum + key[..]) for both half rounds
+ *
+ * \param *k 128 bit key
+ * \param *rk0 32 round keys for v0 update
+ * \param *rk1 32 round keys for v1 update
+ *******************************************************************************/
+static void xtea_round_keys(const uint8_t *k, uint32_t *rk0, uint32_t *rk1)
+{
+	uint32_t key[4];
+	uint32_t sum = 0;
+	int i;
+
+	for(i=0;i<4;i++)
+		key[i] = ld32((const uint8_t *)k+4*i);
+	for(i=0;i<XTEA_ROUNDS;i++)
+	{
+		rk0[i] = sum + key[sum & 3];
+		sum += XTEA_DELTA;
+		rk1[i] = sum + key[(sum>>11) & 3];
+	}
+}
+
+/*!
+ ********************************************************************************
+ * xtea_enc
+ *
+ * scalar reference, same result as xtea_enc in xtea-asm.S
+ *******************************************************************************/
+void xtea_enc(void *dest, const void *v, const void *k)
+{
+	uint32_t v0 = ld32((const uint8_t *)v);
+	uint32_t v1 = ld32((const uint8_t *)v+4);
+	uint32_t key[4];
+	uint32_t sum = 0;
+	int i;
+
+	for(i=0;i<4;i++)
+		key[i] = ld32((const uint8_t *)k+4*i);
+	for(i=0;i<XTEA_ROUNDS;i++)
+	{
+		v0 += (((v1<<4) ^ (v1>>5)) + v1) ^ (sum + key[sum & 3]);
+		sum += XTEA_DELTA;
+		v1 += (((v0<<4) ^ (v0>>5)) + v0) ^ (sum + key[(sum>>11) & 3]);
+	}
+	st32((uint8_t *)dest, v0);
+	st32((uint8_t *)dest+4, v1);
+}
+
+/*!
+ ********************************************************************************
+ * xtea_dec
+ *
+ * inverse of xtea_enc (firmware is built without XTEA_DEC)
+ *******************************************************************************/
+void xtea_dec(void *dest, const void *v, const void *k)
+{
+	uint32_t v0 = ld32((const uint8_t *)v);
+	uint32_t v1 = ld32((const uint8_t *)v+4);
+	uint32_t key[4];
+	uint32_t sum = (uint32_t)(XTEA_DELTA * XTEA_ROUNDS);
+	int i;
+
+	for(i=0;i<4;i++)
+		key[i] = ld32((const uint8_t *)k+4*i);
+	for(i=0;i<XTEA_ROUNDS;i++)
+	{
+		v1 -= (((v0<<4) ^ (v0>>5)) + v0) ^ (sum + key[(sum>>11) & 3]);
+		sum -= XTEA_DELTA;
+		v0 -= (((v1<<4) ^ (v1>>5)) + v1) ^ (sum + key[sum & 3]);
+	}
+	st32((uint8_t *)dest, v0);
+	st32((uint8_t *)dest+4, v1);
+}
+
+static void xtea_blocks_scalar(uint8_t *dest, const uint8_t *src, size_t n,
+		const uint32_t *rk0, const uint32_t *rk1)
+{
+	size_t b;
+	int i;
+
+	for(b=0;b<n;b++)
+	{
+		uint32_t v0 = ld32(src+8*b);
+		uint32_t v1 = ld32(src+8*b+4);
+		for(i=0;i<XTEA_ROUNDS;i++)
+		{
+			v0 += (((v1<<4) ^ (v1>>5)) + v1) ^ rk0[i];
+			v1 += (((v0<<4) ^ (v0>>5)) + v0) ^ rk1[i];
+		}
+		st32(dest+8*b, v0);
+		st32(dest+8*b+4, v1);
+	}
+}
+
+#if XTEA_X86
+
+/* x86 is little endian, blocks can be loaded directly */
+__attribute__((target("sse2")))
+static size_t xtea_blocks_sse2(uint8_t *dest, const uint8_t *src, size_t n,
+		const uint32_t *rk0, const uint32_t *rk1)
+{
+	size_t b;
+	int i;
+
+	for(b=0;b+4<=n;b+=4)
+	{
+		__m128i x = _mm_loadu_si128((const __m128i *)(src+8*b));    /* a0 a1 b0 b1 */
+		__m128i y = _mm_loadu_si128((const __m128i *)(src+8*b+16)); /* c0 c1 d0 d1 */
+		__m128i t0 = _mm_unpacklo_epi32(x, y);                      /* a0 c0 a1 c1 */
+		__m128i t1 = _mm_unpackhi_epi32(x, y);                      /* b0 d0 b1 d1 */
+		__m128i v0 = _mm_unpacklo_epi32(t0, t1);                    /* a0 b0 c0 d0 */
+		__m128i v1 = _mm_unpackhi_epi32(t0, t1);                    /* a1 b1 c1 d1 */
+
+		for(i=0;i<XTEA_ROUNDS;i++)
+		{
+			__m128i f;
+			f = _mm_xor_si128(_mm_slli_epi32(v1, 4), _mm_srli_epi32(v1, 5));
+			f = _mm_add_epi32(f, v1);
+			v0 = _mm_add_epi32(v0, _mm_xor_si128(f, _mm_set1_epi32(rk0[i])));
+			f = _mm_xor_si128(_mm_slli_epi32(v0, 4), _mm_srli_epi32(v0, 5));
+			f = _mm_add_epi32(f, v0);
+			v1 = _mm_add_epi32(v1, _mm_xor_si128(f, _mm_set1_epi32(rk1[i])));
+		}
+		_mm_storeu_si128((__m128i *)(dest+8*b), _mm_unpacklo_epi32(v0, v1));
+		_mm_storeu_si128((__m128i *)(dest+8*b+16), _mm_unpackhi_epi32(v0, v1));
+	}
+	return b;
+}
+
+__attribute__((target("avx2")))
+static size_t xtea_blocks_avx2(uint8_t *dest, const uint8_t *src, size_t n,
+		const uint32_t *rk0, const uint32_t *rk1)
+{
+	/* even dwords are v0, odd dwords are v1 of 8 consecutive blocks */
+	const __m256i idx0 = _mm256_setr_epi32(0, 2, 4, 6, 8, 10, 12, 14);
+	const __m256i idx1 = _mm256_setr_epi32(1, 3, 5, 7, 9, 11, 13, 15);
+	size_t b;
+	int i;
+
+	for(b=0;b+8<=n;b+=8)
+	{
+		__m256i v0 = _mm256_i32gather_epi32((const int *)(src+8*b), idx0, 4);
+		__m256i v1 = _mm256_i32gather_epi32((const int *)(src+8*b), idx1, 4);
+		__m256i lo, hi;
+
+		for(i=0;i<XTEA_ROUNDS;i++)
+		{
+			__m256i f;
+			f = _mm256_xor_si256(_mm256_slli_epi32(v1, 4), _mm256_srli_epi32(v1, 5));
+			f = _mm256_add_epi32(f, v1);
+			v0 = _mm256_add_epi32(v0, _mm256_xor_si256(f, _mm256_set1_epi32(rk0[i])));
+			f = _mm256_xor_si256(_mm256_slli_epi32(v0, 4), _mm256_srli_epi32(v0, 5));
+			f = _mm256_add_epi32(f, v0);
+			v1 = _mm256_add_epi32(v1, _mm256_xor_si256(f, _mm256_set1_epi32(rk1[i])));
+		}
+		/* unpack works per 128 bit lane: lo = blocks 0 1 4 5, hi = blocks 2 3 6 7 */
+		lo = _mm256_unpacklo_epi32(v0, v1);
+		hi = _mm256_unpackhi_epi32(v0, v1);
+		_mm256_storeu_si256((__m256i *)(dest+8*b), _mm256_permute2x128_si256(lo, hi, 0x20));
+		_mm256_storeu_si256((__m256i *)(dest+8*b+32), _mm256_permute2x128_si256(lo, hi, 0x31));
+	}
+	return b;
+}
+
+#endif /* XTEA_X86 */
+
+static xtea_impl_t impl_selected = XTEA_IMPL_AUTO;
+
+/*!
+ ********************************************************************************
+ * xtea_set_impl
+ *
+ * select implementation for xtea_enc_blocks, used by selftest and benchmark
+ *
+ * \param impl wanted implementation, XTEA_IMPL_AUTO for best one
+ * \returns implementation really used (unsupported falls back)
+ *******************************************************************************/
+xtea_impl_t xtea_set_impl(xtea_impl_t impl)
+{
+#if XTEA_X86
+	__builtin_cpu_init();
+	if(impl == XTEA_IMPL_AUTO)
+		impl = XTEA_IMPL_AVX2;
+	if(impl == XTEA_IMPL_AVX2 && !__builtin_cpu_supports("avx2"))
+		impl = XTEA_IMPL_SSE2;
+	if(impl == XTEA_IMPL_SSE2 && !__builtin_cpu_supports("sse2"))
+		impl = XTEA_IMPL_SCALAR;
+#else
+	impl = XTEA_IMPL_SCALAR;
+#endif
+	impl_selected = impl;
+	return impl;
+}
+
+const char *xtea_impl_name(xtea_impl_t impl)
+{
+	switch(impl)
+	{
+		case XTEA_IMPL_SCALAR:	return "scalar";
+		case XTEA_IMPL_SSE2:	return "sse2";
+		case XTEA_IMPL_AVX2:	return "avx2";
+		default:		return "auto";
+	}
+}
+
+/*!
+ ********************************************************************************
+ * xtea_enc_blocks
+ *
+ * encrypt n independent 8 byte blocks with the same key
+ *
+ * \param *dest output, n*8 bytes, may be equal to src
+ * \param *src input, n*8 bytes
+ * \param n number of blocks
+ * \param *k 128 bit key
+ *******************************************************************************/
+void xtea_enc_blocks(uint8_t *dest, const uint8_t *src, size_t n, const uint8_t *k)
+{
+	uint32_t rk0[XTEA_ROUNDS], rk1[XTEA_ROUNDS];
+	size_t done = 0;
+
+	if(impl_selected == XTEA_IMPL_AUTO)
+		xtea_set_impl(XTEA_IMPL_AUTO);
+	xtea_round_keys(k, rk0, rk1);
+#if XTEA_X86
+	if(impl_selected == XTEA_IMPL_AVX2)
+		done = xtea_blocks_avx2(dest, src, n, rk0, rk1);
+	if(impl_selected >= XTEA_IMPL_SSE2)
+		done += xtea_blocks_sse2(dest+8*done, src+8*done, n-done, rk0, rk1);
+#endif
+	xtea_blocks_scalar(dest+8*done, src+8*done, n-done, rk0, rk1);
+}
@@ -0,0 +1,53 @@
+/*
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License as
+ * published by the Free Software Foundation; either version 2 of the
+ * License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public
+ * License along with this program; if not, write to the
+ * Free Software Foundation, Inc., 59 Temple Place - Suite 330,
+ * Boston, MA 02111-1307, USA.
+ */
+
+/*!
+ * \file	xtea.h
+ * \brief	host side XTEA, byte compatible with rfmsrc/common/xtea-asm.S
+ *
+ * The AVR code works on little endian 32 bit words for both block and
+ * key, this implementation does the same on any host.
+ */
+
+#ifndef __XTEA_H__
+#define __XTEA_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#define XTEA_BLOCKSIZEB 8
+#define XTEA_KEYSIZEB 16
+
+/*! available implementations of xtea_enc_blocks */
+typedef enum {
+	XTEA_IMPL_AUTO = 0,
+	XTEA_IMPL_SCALAR,
+	XTEA_IMPL_SSE2,
+	XTEA_IMPL_AVX2
+} xtea_impl_t;
+
+/* same prototype as firmware xtea.h, dest may be equal to v */
+extern void xtea_enc(void *dest, const void *v, const void *k);
+extern void xtea_dec(void *dest, const void *v, const void *k);
+
+/* encrypt n independent blocks with one key, dest may be equal to src */
+extern void xtea_enc_blocks(uint8_t *dest, const uint8_t *src, size_t n, const uint8_t *k);
+
+extern xtea_impl_t xtea_set_impl(xtea_impl_t impl);
+extern const char *xtea_impl_name(xtea_impl_t impl);
+
+#endif
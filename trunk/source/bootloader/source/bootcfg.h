@@ -51,10 +51,25 @@
 //baudrate
 #define BAUDRATE           9600
 
-//Boot section start address(byte)
+//baudrate after 'B' command from host, 0 disable
+//4MHz: 38400 is maximum with error < 2% (double speed mode)
+#define BAUDRATE_FAST      38400
+
+//accept XMODEM-1K blocks (<stx>, 1024 bytes) too
+#define XMODEM1K           1
+
+//'K' command: send checksum of every application page, host skips unchanged pages
+#define PAGECRC            1
+
+//over the air update: application stages delta below BootStart, bootloader applies it
+//OTA_* addresses are in rfmsrc/common/flash_layout.h
+#define OTA                1
+
+//Boot section start address(byte), 2KB boot section (BOOTSZ=00)
+//set in rfmsrc/common/flash_layout.h, Makefile links .text there too
 //define BootStart to 0 will disable this function
-#define BootStart          0x1E00 * 2
-//#define BootStart          0x1C00 * 2
+#include "../../../../rfmsrc/common/flash_layout.h"
+#define BootStart          BOOT_START
 
 //verify flash's data while write
 //ChipCheck will only take effect while BootStart enable also
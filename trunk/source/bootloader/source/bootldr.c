@@ -30,6 +30,8 @@
   Date:          2007.9
 
   Modify:        Add your modify log here
+                 OpenHR20: streaming XModem-1K, fast baudrate switch,
+                 page CRC report for incremental update
 
   See readme.txt to get more information.
 
@@ -37,17 +39,21 @@
 
 #include "bootcfg.h"
 #include "bootldr.h"
+#include <util/crc16.h>
 
 //user's application start address
 #define PROG_START         0x0000
 
-//receive buffer' size will not smaller than SPM_PAGESIZE
-#if BUFFERSIZE < SPM_PAGESIZE
-#define BUFSIZE SPM_PAGESIZE
+//Flash above this address is never written
+#if BootStart
+#define APP_END            BootStart
 #else
-#define BUFSIZE BUFFERSIZE
+#define APP_END            (FLASHEND + 1UL)
 #endif
 
+//receive buffer, two Flash pages: one is received while other one is programmed
+#define BUFSIZE            (2 * SPM_PAGESIZE)
+
 //define receive buffer
 unsigned char buf[BUFSIZE];
 
@@ -61,28 +67,51 @@ unsigned char ch, cl;
 
 //Flash address
 #if FLASHEND > 0xFFFFUL
-unsigned long int FlashAddr;
+unsigned long int FlashAddr, PageAddr;
 #else
-unsigned int FlashAddr;
+unsigned int FlashAddr, PageAddr;
 #endif
 
+//background page programming  0:idle  1:erase  2:write
+unsigned char pagstate;
+unsigned char *pagbuf;
 
-//update one Flash page
-void write_one_page(unsigned char *buf)
+
+//continue programming of one Flash page
+//boot section is NRWW, CPU keeps running and receiving while SPM is busy
+void page_task(void)
 {
-  boot_page_erase(FlashAddr);                  //erase one Flash page
-  boot_spm_busy_wait();
-  for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr += 2) //fill data to Flash buffer
+  if(boot_spm_busy())
+    return;
+  if(pagstate == 1)                            //erase done, fill data to Flash buffer
   {
-    boot_page_fill(pagptr, buf[pagptr] + (buf[pagptr + 1] << 8));
+    for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr += 2)
+    {
+      boot_page_fill(pagptr, pagbuf[pagptr] + (pagbuf[pagptr + 1] << 8));
+    }
+    boot_page_write(PageAddr);                 //write buffer to one Flash page
+    pagstate = 2;
   }
-  boot_page_write(FlashAddr);                  //write buffer to one Flash page
-  boot_spm_busy_wait();                        //wait Flash page write finish
+  else
+    pagstate = 0;
+}
+
+//start update of one Flash page
+//previous page is finished long before next one is received
+void page_start(unsigned char *p)
+{
+  while(pagstate)
+    page_task();
+  pagbuf = p;
+  boot_page_erase(PageAddr);                   //erase one Flash page
+  pagstate = 1;
 }
 
 //jump to user's application
 void quit()
 {
+  while(pagstate)                              //finish last page
+    page_task();
   boot_rww_enable();                           //enable application section
   (*((void(*)(void))PROG_START))();            //jump
 }
@@ -104,10 +133,11 @@ void WriteCom(unsigned char dat)
 #endif
 }
 
-//wait receive a data from comport
+//wait receive a data from comport, Flash programming continue meanwhile
 unsigned char WaitCom()
 {
-  while(!DataInCom());
+  while(!DataInCom())
+    page_task();
   return ReadCom();
 }
 
@@ -121,53 +151,150 @@ void putstr(const char *str)
 }
 #endif
 
-//calculate CRC checksum
-#if BUFSIZE > 255
-void crc16(unsigned char *buf)
+//update checksum with one byte
+unsigned int crc16(unsigned int crc, unsigned char dat)
 {
-  unsigned int j;
-#else
-void crc16(unsigned char *buf)
-{
-  unsigned char j;
-#endif
-
 #if CRCMODE == 0
-  unsigned char i;
-  unsigned int t;
+  //CRC1021 checksum
+  return _crc_xmodem_update(crc, dat);
+#elif CRCMODE == 1
+  //word add up checksum
+  return crc + dat;
 #endif
-  unsigned int crc;
+}
 
-  crc = 0;
-  for(j = BUFFERSIZE; j > 0; j--)
+#if OTA
+//SPM service for application, it can write OTA staging area only
+//called through SPM_READY vector of boot section, bootloader never enable this interrupt
+//op 0: fill one word of page buffer, op 1: erase and write page
+void SPM_READY_vect(unsigned char op, unsigned int addr, unsigned int data) __attribute__((used));
+void SPM_READY_vect(unsigned char op, unsigned int addr, unsigned int data)
+{
+  unsigned char sreg = SREG;
+
+  if((addr < OTA_STAGE_START) || (addr >= OTA_STAGE_START + OTA_STAGE_SIZE))
+    return;
+  //application section is not readable during SPM, interrupt vectors are there
+  __asm__ __volatile__("cli": : );
+  if(op == 0)
+    boot_page_fill(addr, data);
+  else
   {
-#if CRCMODE == 0
-    //CRC1021 checksum
-    crc = (crc ^ (((unsigned int) *buf) << 8));
-    for(i = 8; i > 0; i--)
+    boot_page_erase(addr);
+    boot_spm_busy_wait();
+    boot_page_write(addr);
+    boot_spm_busy_wait();
+    boot_rww_enable();
+  }
+  SREG = sreg;
+}
+
+//write page in buf to Flash and wait, Flash is read right after it
+void ota_write(unsigned int addr)
+{
+  PageAddr = addr;
+  page_start(buf);
+  while(pagstate)
+    page_task();
+  boot_rww_enable();
+}
+
+//mark page in backup, 0xFF: backup is not needed
+void ota_mark(unsigned char page)
+{
+  eeprom_write_byte((unsigned char *)(OTA_PAGE_EEADDR - 1), ~page);
+  eeprom_write_byte((unsigned char *)OTA_PAGE_EEADDR, page);
+}
+
+//write page in buf to FlashAddr through backup page
+void ota_flush(void)
+{
+  if(FlashAddr >= OTA_STAGE_START)
+    return;
+  ota_write(OTA_BACKUP_START);
+  ota_mark(FlashAddr / SPM_PAGESIZE);
+  ota_write(FlashAddr);
+  eeprom_write_byte((unsigned char *)OTA_PAGE_EEADDR, 0xFF);
+}
+
+//apply delta committed by application
+//header: 'D' version base_pages crc_h crc_l (checked by application)
+//records: addr_h addr_l count data[count], count 0 ends
+//records only set bytes, update interrupted by reset is applied again
+//after page which was erased at reset is restored from backup page
+void ota_apply(void)
+{
+  unsigned int src = OTA_STAGE_START + 5;
+  unsigned int addr;
+  unsigned char n;
+
+  if(eeprom_read_byte((unsigned char *)OTA_FLAG_EEADDR) != OTA_FLAG_COMMIT)
+    return;
+  n = eeprom_read_byte((unsigned char *)OTA_PAGE_EEADDR);
+  if((n == (unsigned char)~eeprom_read_byte((unsigned char *)(OTA_PAGE_EEADDR - 1)))
+    && (n < OTA_STAGE_START / SPM_PAGESIZE))
+  {
+    for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr++)
+      buf[pagptr] = pgm_read_byte(OTA_BACKUP_START + pagptr);
+    ota_write(n * SPM_PAGESIZE);
+    eeprom_write_byte((unsigned char *)OTA_PAGE_EEADDR, 0xFF);
+  }
+  FlashAddr = OTA_STAGE_START;                 //no page loaded
+  while(src < OTA_STAGE_START + OTA_STAGE_SIZE - 3)
+  {
+    addr = (pgm_read_byte(src) << 8) | pgm_read_byte(src + 1);
+    n = pgm_read_byte(src + 2);
+    src += 3;
+    if(n == 0)
+      break;
+    for(; n > 0; n--, addr++)
     {
-      t = crc << 1;
-      if(crc & 0x8000)
-        t = t ^ 0x1021;
-      crc = t;
+      if(addr >= OTA_STAGE_START)              //never patch staging area and bootloader
+        break;
+      if((addr & ~(SPM_PAGESIZE - 1)) != FlashAddr)
+      {
+        ota_flush();
+        FlashAddr = addr & ~(SPM_PAGESIZE - 1);
+        for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr++)
+          buf[pagptr] = pgm_read_byte(FlashAddr + pagptr);
+      }
+      buf[addr % SPM_PAGESIZE] = pgm_read_byte(src++);
     }
-#elif CRCMODE == 1
-    //word add up checksum
-    crc += (unsigned int)(*buf);
-#elif
-
+    src += n;                                  //rest of skipped record
+  }
+  ota_flush();
+  eeprom_write_byte((unsigned char *)OTA_FLAG_EEADDR, 0xFF);
+}
 #endif
-    buf++;
+
+#if PAGECRC
+//send checksum of every application Flash page, host skips unchanged pages
+void send_page_crc(void)
+{
+  unsigned int crc;
+
+  WriteCom(XMODEM_PAGECRC);
+  WriteCom(APP_END / SPM_PAGESIZE);
+  for(FlashAddr = 0; FlashAddr < APP_END; FlashAddr += SPM_PAGESIZE)
+  {
+    crc = 0;
+    for(pagptr = 0; pagptr < SPM_PAGESIZE; pagptr++)
+      crc = crc16(crc, pgm_read_byte(FlashAddr + pagptr));
+    WriteCom(crc / 256);
+    WriteCom(crc % 256);
   }
-  ch = crc / 256;
-  cl = crc % 256;
 }
+#endif
 
 int main(void)
 {
   unsigned char cnt;
   unsigned char packNO;
   unsigned char crch, crcl;
+  unsigned char skip;
+  unsigned char dat;
+  unsigned int crc;
+  unsigned long int addr;
 
 #if InitDelay > 255
   unsigned int di;
@@ -175,11 +302,7 @@ int main(void)
   unsigned char di;
 #endif
 
-#if BUFFERSIZE > 255
-  unsigned int li;
-#else
-  unsigned char li;
-#endif
+  unsigned int li, blksize;
 
   //disable interrupt
   __asm__ __volatile__("cli": : );
@@ -205,6 +328,11 @@ int main(void)
   //initialize comport with special config value
   ComInit();
 
+#if OTA
+  //update staged over the air
+  ota_apply();
+#endif
+
 #if InitDelay
   //some kind of avr mcu need special delay after comport initialization
   for(di = InitDelay; di > 0; di--)
@@ -294,7 +422,7 @@ int main(void)
   putstr(msg3);
 #endif
 
-  //every interval send a "C",waiting XMODEM control command <soh>
+  //every interval send a "C",waiting XMODEM control command <soh>/<stx>
   cnt = TimeOutCntC;
   while(1)
   {
@@ -326,124 +454,97 @@ int main(void)
 
     if(DataInCom())
     {
-      if(ReadCom() == XMODEM_SOH)  //XMODEM command <soh>
+      cl = ReadCom();
+      if(cl == XMODEM_SOH)     //XMODEM command <soh>
+        break;
+#if XMODEM1K
+      if(cl == XMODEM_STX)     //XMODEM-1K command <stx>
         break;
+#endif
+#if BAUDRATE_FAST
+      if(cl == XMODEM_BAUD)    //answer on old baudrate, then switch
+      {
+        WriteCom(XMODEM_BAUD);
+        ComFast();
+      }
+#endif
+#if PAGECRC
+      if(cl == XMODEM_PAGECRC)
+      {
+        send_page_crc();
+        cnt = TimeOutCntC;
+      }
+#endif
+      if(cl == XMODEM_EOT)     //nothing to update
+      {
+        WriteCom(XMODEM_ACK);
+        quit();
+      }
     }
   }
   //close timer1
   TCCR1B = 0;
 
-  //begin to receive data
+  //begin to receive data, first block header is in cl
   packNO = 0;
   bufptr = 0;
   cnt = 0;
   FlashAddr = 0;
   do
   {
-    packNO++;
+    blksize = BUFFERSIZE;
+#if XMODEM1K
+    if(cl == XMODEM_STX)
+      blksize = 1024;
+#endif
     ch =  WaitCom();                          //get package number
     cl = ~WaitCom();
-    if ((packNO == ch) && (packNO == cl))
+    //missing package numbers skip Flash in units of BUFFERSIZE (unchanged pages),
+    //repeated number is resend after lost ACK and it is not written again
+    skip = ch - packNO - 1;
+    addr = FlashAddr + (unsigned long int)skip * BUFFERSIZE;
+    crc = 0;
+    for(li = 0; li < blksize; li++)           //receive a full data frame
     {
-      for(li = 0; li < BUFFERSIZE; li++)      //receive a full data frame
+      dat = WaitCom();
+      crc = crc16(crc, dat);
+      if((ch == cl) && (skip != 0xFF) && (addr + li < APP_END))
       {
-        buf[bufptr++] = WaitCom();
-      }
-      crch = WaitCom();                       //get checksum
-      crcl = WaitCom();
-      crc16(&buf[bufptr - BUFFERSIZE]);       //calculate checksum
-      if((crch == ch) && (crcl == cl))
-      {
-#if BootStart
-        if(FlashAddr < BootStart)             //avoid write to boot section
+        buf[bufptr++] = dat;
+        if((bufptr % SPM_PAGESIZE) == 0)      //Flash page full, program it while next one is received
         {
-#endif
-
-#if BUFFERSIZE < SPM_PAGESIZE
-          if(bufptr >= SPM_PAGESIZE)          //Flash page full, write flash page;otherwise receive next frame
-          {                                   //receive multi frames, write one page
-            write_one_page(buf);              //write data to Flash
-            FlashAddr += SPM_PAGESIZE;        //modify Flash page address
+          PageAddr = addr + li + 1 - SPM_PAGESIZE;
+          page_start(&buf[bufptr - SPM_PAGESIZE]);
+          if(bufptr >= BUFSIZE)
             bufptr = 0;
-          }
-#else
-          while(bufptr > 0)                   //receive one frame, write multi pages
-          {
-            write_one_page(&buf[BUFSIZE - bufptr]);
-            FlashAddr += SPM_PAGESIZE;        //modify Flash page address
-            bufptr -= SPM_PAGESIZE;
-          }
-#endif
-
-#if BootStart
-        }
-        else                                  //ignore flash write when Flash address exceed BootStart
-        {
-          bufptr = 0;                         //reset receive pointer
-        }
-#endif
-
-//read flash, compare with buffer's content
-#if (ChipCheck > 0) && (BootStart > 0)
-#if BUFFERSIZE < SPM_PAGESIZE
-        if((bufptr == 0) && (FlashAddr <= BootStart))
-#else
-        if(FlashAddr <= BootStart)
-#endif
-        {
-          boot_rww_enable();                  //enable application section
-          cl = 1;                             //clear error flag
-          for(pagptr = 0; pagptr < BUFSIZE; pagptr++)
-          {
-            if(pgm_read_byte(FlashAddr - BUFSIZE + pagptr) != buf[pagptr])
-            {
-              cl = 0;                         //set error flag
-              break;
-            }
-          }
-          if(cl)                              //checksum equal, send ACK
-          {
-            WriteCom(XMODEM_ACK);
-            cnt = 0;
-          }
-          else
-          {
-            WriteCom(XMODEM_NAK);             //checksum error, ask resend
-            cnt++;                            //increase error counter
-            FlashAddr -= BUFSIZE;             //modify Flash page address
-          }
-        }
-        else                                  //no verify, send ACK directly
-        {
-          WriteCom(XMODEM_ACK);
-          cnt = 0;
         }
-#else
-        //no verify, send ACK directly
-        WriteCom(XMODEM_ACK);
-        cnt = 0;
-#endif
+      }
+    }
+    crch = WaitCom();                         //get checksum
+    crcl = WaitCom();
+    if((ch == cl) && (crch == crc / 256) && (crcl == crc % 256))
+    {
+      if(skip != 0xFF)
+      {
+        FlashAddr = addr + blksize;           //modify Flash page address
+        packNO = ch;
+      }
+      WriteCom(XMODEM_ACK);
+      cnt = 0;
 
 #if WDGEn
-        //clear watchdog
-        wdt_reset();
+      //clear watchdog
+      wdt_reset();
 #endif
 
 #if LEDEn
-        //LED indicate update status
-        LEDAlt();
+      //LED indicate update status
+      LEDAlt();
 #endif
-      }
-      else //CRC
-      {
-        //ask resend
-        WriteCom(XMODEM_NAK);
-        cnt++;
-      }
     }
-    else //PackNo
+    else //PackNo or CRC
     {
-      //ask resend
+      //ask resend, pages programmed from bad block are written again
       WriteCom(XMODEM_NAK);
       cnt++;
     }
@@ -451,7 +552,7 @@ int main(void)
     if(cnt > 3)
       break;
   }
-  while(WaitCom() != XMODEM_EOT);
+  while((cl = WaitCom()) != XMODEM_EOT);
   WriteCom(XMODEM_ACK);
 
 
@@ -43,6 +43,7 @@
 #include <avr/boot.h>
 #include <avr/pgmspace.h>
 #include <avr/interrupt.h>
+#include <avr/eeprom.h>
 
 //Don't modify code below, unless your really konw what to do
 
@@ -82,6 +83,28 @@
 #error "BaudRate error > 2% ! Please check BaudRate and F_CPU value."
 #endif
 
+#if BAUDRATE_FAST
+//fast baudrate use double speed mode (U2X)
+#define BAUDREG_FAST       ((unsigned int)((F_CPU * 10) / (8UL * BAUDRATE_FAST) - 5) / 10)
+#define FreqTempFast       (8UL * BAUDRATE_FAST * (((F_CPU * 10) / (8 * BAUDRATE_FAST) + 5)/ 10))
+#if ((FreqTempFast * 50) > (51 * F_CPU) || (FreqTempFast * 50) < (49 * F_CPU))
+#error "BaudRate error > 2% ! Please check BAUDRATE_FAST and F_CPU value."
+#endif
+#endif
+
+#if OTA && !BootStart
+#error "OTA staging area is below BootStart, BootStart must be defined"
+#endif
+
+#if OTA && (OTA_BACKUP_SIZE != SPM_PAGESIZE)
+#error "OTA_BACKUP_SIZE in flash_layout.h must be one Flash page"
+#endif
+
+//streaming receive write Flash pages before block checksum is known
+#if ChipCheck
+#error "ChipCheck is not supported, Flash is programmed while data are received"
+#endif
+
 #define True               1
 #define False              0
 #define TRUE               1
@@ -101,6 +124,7 @@
 #define RXENBIT(No)        CONCAT(RXEN, No)
 #define TXENBIT(No)        CONCAT(TXEN, No)
 #define URSELBIT(No)       CONCAT(URSEL, No)
+#define U2XBIT(No)         CONCAT(U2X, No)
 
 //comport register
 #define UBRRHREG(No)       CONCAT3(UBRR, No, H)
@@ -132,6 +156,7 @@
 #define UCSZ01             UCSZ1
 #define UCSZ00             UCSZ0
 #define URSEL0             URSEL
+#define U2X0               U2X
 #endif
 
 //initialize comport
@@ -144,6 +169,14 @@
                            UBRRLREG(COMPORTNo) = BAUDREG%256;             \
         }
 
+//switch comport to fast baudrate, last byte must be sent already
+#define ComFast()                                                         \
+        {                                                                 \
+                           UCSRAREG(COMPORTNo) = (1 << U2XBIT(COMPORTNo));\
+                           UBRRHREG(COMPORTNo) = BAUDREG_FAST/256;        \
+                           UBRRLREG(COMPORTNo) = BAUDREG_FAST%256;        \
+        }
+
 //prompt messages
 #if VERBOSE
 #if LEVELMODE
@@ -191,6 +224,9 @@ const char msg5[] = "update fail.";
 #define XMODEM_CAN         0x18
 #define XMODEM_EOF         0x1A
 #define XMODEM_RWC         'C'
+//extension: switch to BAUDRATE_FAST, send page checksums
+#define XMODEM_BAUD        'B'
+#define XMODEM_PAGECRC     'K'
 
 #if RS485
 #define RS485Enable()      PORTREG(RS485PORT) |= (1 << RS485TXEn)